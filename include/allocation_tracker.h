@@ -0,0 +1,253 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+namespace utils
+{
+
+	struct AllocationCounts
+	{
+		uint64_t allocations = 0;
+		uint64_t bytes = 0;
+
+		AllocationCounts operator-(const AllocationCounts& other) const
+		{
+			return { allocations - other.allocations, bytes - other.bytes };
+		}
+	};
+
+	/// Counts heap allocations, both per thread and per tag, where a tag is the innermost `AllocationScope` that is
+	/// alive on the allocating thread (allocations outside of any scope are tagged "Untagged")
+	///
+	/// Nothing is counted unless the program is built with `GRIDKNOT_TRACK_ALLOCATIONS` (the CMake option of the
+	/// same name), which links in replacements for the global `operator new` / `operator delete` that report every
+	/// allocation here. Otherwise, all of the counts stay at zero and scopes cost next to nothing. Tags are only
+	/// attached to the thread that opened the scope: work that is handed off to a thread pool isn't tagged.
+	class AllocationTracker
+	{
+
+	public:
+
+		/// The maximum number of distinct tags (any further tags are merged into the last one)
+		static constexpr size_t max_tags = 32;
+
+		struct TagCounts
+		{
+			const char* name = nullptr;
+			AllocationCounts counts;
+
+			// The number of times that a scope with this tag was entered
+			uint64_t scopes = 0;
+		};
+
+		using TagTable = std::array<TagCounts, max_tags>;
+
+		static constexpr bool is_enabled()
+		{
+#if defined(GRIDKNOT_TRACK_ALLOCATIONS)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		/// Returns the counts of every thread since the program started.
+		static AllocationCounts get_total_counts()
+		{
+			return { total_allocations.load(std::memory_order_relaxed), total_bytes.load(std::memory_order_relaxed) };
+		}
+
+		/// Returns the counts of the calling thread since it started.
+		static AllocationCounts get_thread_counts()
+		{
+			return thread_counts;
+		}
+
+		/// Returns the counts of every tag that has been used so far (unused entries have a null `name`). This
+		/// doesn't allocate, so it can be called from inside of a scope without disturbing its counts.
+		static TagTable get_tag_counts()
+		{
+			TagTable table;
+			for (size_t i = 0; i < max_tags; ++i)
+			{
+				table[i].name = i == 0 ? "Untagged" : tags[i].name.load(std::memory_order_acquire);
+				table[i].counts = { tags[i].allocations.load(std::memory_order_relaxed), tags[i].bytes.load(std::memory_order_relaxed) };
+				table[i].scopes = tags[i].scopes.load(std::memory_order_relaxed);
+			}
+
+			return table;
+		}
+
+		/// Returns the number of allocations that were made inside of a `NoAllocationScope` (on any thread).
+		static uint64_t get_violations()
+		{
+			return violations.load(std::memory_order_relaxed);
+		}
+
+		/// Called by the replacement `operator new` for every allocation. This must not allocate (or throw).
+		static void record(size_t bytes) noexcept
+		{
+			thread_counts.allocations++;
+			thread_counts.bytes += bytes;
+
+			total_allocations.fetch_add(1, std::memory_order_relaxed);
+			total_bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+			auto& tag = tags[current_tag];
+			tag.allocations.fetch_add(1, std::memory_order_relaxed);
+			tag.bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+			if (forbidden_depth > 0)
+			{
+				violations.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+	private:
+
+		struct Tag
+		{
+			std::atomic<const char*> name;
+			std::atomic<uint64_t> allocations;
+			std::atomic<uint64_t> bytes;
+			std::atomic<uint64_t> scopes;
+		};
+
+		// All of these have constant (zero) initialization, so they are usable before `main` and from any thread
+		// without any allocations of their own
+		inline static std::array<Tag, max_tags> tags;
+		inline static std::atomic<uint64_t> total_allocations;
+		inline static std::atomic<uint64_t> total_bytes;
+		inline static std::atomic<uint64_t> violations;
+		inline static thread_local AllocationCounts thread_counts;
+		inline static thread_local size_t current_tag = 0;
+		inline static thread_local size_t forbidden_depth = 0;
+
+		/// Returns the index of `name` in the tag table, adding it if it isn't there yet.
+		static size_t find_tag(const char* name)
+		{
+			// Slot 0 is reserved for allocations outside of any scope
+			for (size_t i = 1; i < max_tags; ++i)
+			{
+				const char* existing = tags[i].name.load(std::memory_order_acquire);
+				if (existing == nullptr && tags[i].name.compare_exchange_strong(existing, name))
+				{
+					return i;
+				}
+				if (existing == name || std::strcmp(existing, name) == 0)
+				{
+					return i;
+				}
+			}
+
+			return max_tags - 1;
+		}
+
+		friend class AllocationScope;
+		friend class NoAllocationScope;
+
+	};
+
+	/// Tags every allocation that the calling thread makes while this is alive with `name`, which must outlive the
+	/// program (i.e. a string literal). Scopes can be nested: the innermost one wins.
+	class AllocationScope
+	{
+
+	public:
+
+		AllocationScope(const char* name) :
+			previous_tag{ AllocationTracker::current_tag },
+			start{ AllocationTracker::get_thread_counts() }
+		{
+			if (AllocationTracker::is_enabled())
+			{
+				AllocationTracker::current_tag = AllocationTracker::find_tag(name);
+				AllocationTracker::tags[AllocationTracker::current_tag].scopes.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		AllocationScope(const AllocationScope& other) = delete;
+
+		AllocationScope& operator=(const AllocationScope& other) = delete;
+
+		~AllocationScope()
+		{
+			AllocationTracker::current_tag = previous_tag;
+		}
+
+		/// Returns the allocations that the calling thread has made since this scope was entered.
+		AllocationCounts get_counts() const
+		{
+			return AllocationTracker::get_thread_counts() - start;
+		}
+
+	private:
+
+		size_t previous_tag;
+		AllocationCounts start;
+
+	};
+
+	/// Writes the counts of every tag (and the totals) to `stream` as a table, including the average number of
+	/// allocations and bytes per scope (e.g. per call to `Knot::relax`, or per Cromwell move).
+	inline void write_allocation_report(std::ostream& stream)
+	{
+		if (!AllocationTracker::is_enabled())
+		{
+			stream << "Allocation tracking is disabled (build with GRIDKNOT_TRACK_ALLOCATIONS to enable it)\n";
+			return;
+		}
+
+		const auto total = AllocationTracker::get_total_counts();
+		stream << "Allocations: " << total.allocations << " (" << total.bytes << " bytes)\n";
+
+		for (const auto& tag : AllocationTracker::get_tag_counts())
+		{
+			if (tag.name == nullptr || (tag.counts.allocations == 0 && tag.scopes == 0))
+			{
+				continue;
+			}
+
+			stream << "  " << tag.name << ": " << tag.counts.allocations << " (" << tag.counts.bytes << " bytes)";
+			if (tag.scopes > 0)
+			{
+				stream << " over " << tag.scopes << " scope(s), " << static_cast<double>(tag.counts.allocations) / tag.scopes
+					<< " (" << static_cast<double>(tag.counts.bytes) / tag.scopes << " bytes) per scope";
+			}
+			stream << "\n";
+		}
+
+		if (AllocationTracker::get_violations() > 0)
+		{
+			stream << "  " << AllocationTracker::get_violations() << " allocation(s) in code that shouldn't allocate\n";
+		}
+	}
+
+	/// Marks a span of code that should never allocate (e.g. a steady-state simulation loop): any allocation that
+	/// the calling thread makes while this is alive is counted as a violation (see `AllocationTracker::get_violations`).
+	class NoAllocationScope
+	{
+
+	public:
+
+		NoAllocationScope()
+		{
+			AllocationTracker::forbidden_depth++;
+		}
+
+		NoAllocationScope(const NoAllocationScope& other) = delete;
+
+		NoAllocationScope& operator=(const NoAllocationScope& other) = delete;
+
+		~NoAllocationScope()
+		{
+			AllocationTracker::forbidden_depth--;
+		}
+
+	};
+
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace utils
+{
+
+	/// A bump ("arena") allocator for temporaries that all die at the same time, e.g. at the end of a frame or a
+	/// time step: each allocation just advances a cursor, deallocation does nothing, and `reset` makes all of the
+	/// memory available again at once
+	///
+	/// Unlike `std::pmr::monotonic_buffer_resource`, an arena holds onto its memory across resets. If a round
+	/// (i.e. everything between two resets) doesn't fit into the current block, the overflow goes into extra
+	/// blocks, which are merged into a single block (big enough for the whole round) on the next reset. From then
+	/// on, rounds of the same size don't touch the upstream resource at all.
+	///
+	/// Pass a pointer to an arena wherever a `std::pmr::memory_resource*` is expected (for example, to the
+	/// constructor of a `std::pmr::vector`). An arena isn't thread-safe, and everything that was allocated from
+	/// it must be destroyed (or at least never touched again) before it is reset.
+	class Arena : public std::pmr::memory_resource
+	{
+
+	public:
+
+		/// Creates an empty arena: the first block (of `initial_capacity` bytes) is only requested from `upstream`
+		/// once something is allocated.
+		explicit Arena(size_t initial_capacity = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) :
+			initial_capacity{ std::max(initial_capacity, size_t{ 64 }) },
+			upstream{ upstream }
+		{}
+
+		Arena(const Arena& other) = delete;
+
+		Arena& operator=(const Arena& other) = delete;
+
+		~Arena()
+		{
+			release();
+		}
+
+		/// Makes all of the memory in this arena available again (merging any overflow blocks into one).
+		void reset()
+		{
+			if (head != nullptr && head->next != nullptr)
+			{
+				const auto capacity = total_capacity;
+				release();
+				push_block(capacity);
+			}
+
+			cursor = head != nullptr ? head->begin() : nullptr;
+			used = 0;
+		}
+
+		/// Returns every block to the upstream resource.
+		void release()
+		{
+			while (head != nullptr)
+			{
+				const auto next = head->next;
+				upstream->deallocate(head, sizeof(Block) + head->capacity, alignof(Block));
+				head = next;
+			}
+
+			cursor = nullptr;
+			used = 0;
+			total_capacity = 0;
+		}
+
+		/// Returns the number of bytes that have been handed out since the last reset (not counting padding).
+		size_t get_used() const
+		{
+			return used;
+		}
+
+		/// Returns the number of bytes in all of the blocks that this arena currently owns.
+		size_t get_capacity() const
+		{
+			return total_capacity;
+		}
+
+	private:
+
+		// The header at the start of each block, which is followed by `capacity` bytes of storage
+		struct alignas(std::max_align_t) Block
+		{
+			Block* next;
+			size_t capacity;
+
+			std::byte* begin()
+			{
+				return reinterpret_cast<std::byte*>(this + 1);
+			}
+
+			std::byte* end()
+			{
+				return begin() + capacity;
+			}
+		};
+
+		void* do_allocate(size_t bytes, size_t alignment) override
+		{
+			auto aligned = align(cursor, alignment);
+			if (head == nullptr || aligned + bytes > head->end())
+			{
+				// Double the size of the blocks, so that a round needs only a handful of them before it's merged
+				push_block(std::max(bytes + alignment, head != nullptr ? head->capacity * 2 : initial_capacity));
+				aligned = align(cursor, alignment);
+			}
+
+			cursor = aligned + bytes;
+			used += bytes;
+
+			return aligned;
+		}
+
+		void do_deallocate(void*, size_t, size_t) override
+		{
+			// Memory is only reclaimed by `reset`
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+
+		/// Starts a new block with room for (at least) `capacity` bytes.
+		void push_block(size_t capacity)
+		{
+			auto block = static_cast<Block*>(upstream->allocate(sizeof(Block) + capacity, alignof(Block)));
+			block->next = head;
+			block->capacity = capacity;
+
+			head = block;
+			cursor = block->begin();
+			total_capacity += capacity;
+		}
+
+		static std::byte* align(std::byte* pointer, size_t alignment)
+		{
+			const auto address = reinterpret_cast<uintptr_t>(pointer);
+			return reinterpret_cast<std::byte*>((address + alignment - 1) & ~(uintptr_t{ alignment } - 1));
+		}
+
+		size_t initial_capacity;
+		std::pmr::memory_resource* upstream;
+
+		// The block that is currently being allocated from (the front of a list of all of the blocks)
+		Block* head = nullptr;
+
+		// The next free byte in `head`
+		std::byte* cursor = nullptr;
+
+		size_t used = 0;
+		size_t total_capacity = 0;
+
+	};
+
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "allocation_tracker.h"
+#include "checkpoint.h"
+#include "diagram.h"
+#include "knot.h"
+#include "thread_pool.h"
+
+namespace knot
+{
+
+	struct BatchSettings
+	{
+		// The number of time steps to relax each knot for
+		size_t iterations = 1000;
+
+		// The parameters used by every knot's simulation
+		SimulationParams params;
+
+		// Whether or not each knot is pulled back towards its starting position
+		bool use_anchors = true;
+
+		// The number of worker threads (0 means one per hardware thread)
+		size_t number_of_threads = 0;
+
+		// The directory where checkpoints are written (an empty string disables checkpointing): if a knot
+		// already has a checkpoint here, it is resumed from that checkpoint rather than started from scratch
+		std::string checkpoint_directory;
+
+		// The number of time steps between consecutive checkpoints of each knot (a final checkpoint is always
+		// written once a knot is done, so that a finished job can be extended later on)
+		size_t checkpoint_interval = 1000;
+	};
+
+	/// A single item in a batch: a named curve that should be relaxed
+	struct BatchJob
+	{
+		std::string name;
+		geom::PolygonalCurve curve;
+	};
+
+	/// Writes relaxed knots to an output stream as an .obj file, where each knot becomes a
+	/// separate object made of a single, closed polyline
+	///
+	/// Knots are written as soon as they finish relaxing (in whatever order that happens to be),
+	/// so this is safe to call from multiple threads at once
+	class BatchWriter
+	{
+
+	public:
+
+		BatchWriter(std::ostream& output) :
+			output{ output }
+		{}
+
+		/// Appends the closed polyline `curve` as a new object called `name`.
+		void write(const std::string& name, const geom::PolygonalCurve& curve)
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+
+			output << "o " << name << "\n";
+			for (const auto& vertex : curve.get_vertices())
+			{
+				output << "v " << vertex.x << " " << vertex.y << " " << vertex.z << "\n";
+			}
+
+			// .obj indices are 1-based and global across all objects in the file
+			output << "l";
+			for (size_t i = 0; i < curve.get_number_of_vertices(); ++i)
+			{
+				output << " " << vertex_offset + i + 1;
+			}
+			output << " " << vertex_offset + 1 << "\n";
+			output.flush();
+
+			if (!output)
+			{
+				throw std::runtime_error("Failed to write " + name);
+			}
+
+			vertex_offset += curve.get_number_of_vertices();
+		}
+
+	private:
+
+		std::ostream& output;
+		std::mutex mutex;
+
+		// The number of vertices that have been written so far
+		size_t vertex_offset = 0;
+	};
+
+	/// Returns the path of the checkpoint file for the knot called `name` (or an empty string if
+	/// checkpointing is disabled). Names are flattened into readable file names, which can collide
+	/// (e.g. `a/b.csv` and `a_b.csv`), so a hash of the full name is appended as well.
+	inline std::string get_checkpoint_path(const BatchSettings& settings, const std::string& name)
+	{
+		if (settings.checkpoint_directory.empty() || settings.checkpoint_interval == 0)
+		{
+			return "";
+		}
+
+		// Job names are usually file paths, so flatten them into a single file name
+		auto file_name = name;
+		std::replace_if(file_name.begin(), file_name.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_'; }, '_');
+
+		std::ostringstream suffix;
+		suffix << std::hex << std::setw(16) << std::setfill('0') << Checkpoint::hash_bytes(name.data(), name.size());
+
+		return (std::filesystem::path{ settings.checkpoint_directory } / (file_name + "-" + suffix.str() + ".ckpt")).string();
+	}
+
+	/// Relaxes all of the knots in `jobs` concurrently and writes each one to `writer` as soon as
+	/// it is finished. Returns the number of knots that were relaxed (and written).
+	///
+	/// A knot that fails (for example, because its checkpoint is truncated, or because the disk is
+	/// full) is reported and skipped, so that one bad knot doesn't bring down the whole batch.
+	///
+	/// The cost of relaxing a knot grows (roughly) quadratically with its number of vertices, so
+	/// the largest knots are scheduled first: idle workers then steal the smaller knots that are
+	/// left over, which keeps every core busy until the very end of the batch.
+	inline size_t relax_batch(std::vector<BatchJob> jobs, const BatchSettings& settings, BatchWriter& writer)
+	{
+		std::sort(jobs.begin(), jobs.end(), [](const BatchJob& a, const BatchJob& b) {
+			return a.curve.get_number_of_vertices() > b.curve.get_number_of_vertices();
+		});
+
+		utils::ThreadPool pool{ settings.number_of_threads == 0 ? std::thread::hardware_concurrency() : settings.number_of_threads };
+
+		std::atomic<size_t> relaxed{ 0 };
+		for (const auto& job : jobs)
+		{
+			pool.submit([&] {
+				try
+				{
+					const auto checkpoint_path = get_checkpoint_path(settings, job.name);
+					const bool resume = !checkpoint_path.empty() && std::filesystem::exists(checkpoint_path);
+
+					// Only resume a checkpoint that was saved from this very curve (the diagram may have changed since)
+					const auto source = Checkpoint::get_source_hash(job.curve);
+					auto knot = resume ? Checkpoint::load(checkpoint_path, source) : Knot{ job.curve, settings.params };
+					while (knot.get_number_of_steps() < settings.iterations)
+					{
+						{
+							// Tagged here, on the worker, since scopes don't follow work onto other threads
+							utils::AllocationScope scope{ "Relax" };
+							knot.relax(settings.use_anchors);
+						}
+
+						if (!checkpoint_path.empty() && knot.get_number_of_steps() % settings.checkpoint_interval == 0)
+						{
+							Checkpoint::save(knot, checkpoint_path, source);
+						}
+					}
+
+					if (!checkpoint_path.empty() && knot.get_number_of_steps() % settings.checkpoint_interval != 0)
+					{
+						Checkpoint::save(knot, checkpoint_path, source);
+					}
+
+					writer.write(job.name, knot.get_rope());
+					relaxed++;
+				}
+				catch (const std::exception& e)
+				{
+					std::cerr << "Failed to relax " << job.name << ": " << e.what() << std::endl;
+				}
+			});
+		}
+		pool.wait();
+
+		return relaxed;
+	}
+
+	/// Loads every grid diagram in `csvs` and builds its curve (in parallel), skipping (and
+	/// reporting) any files that don't contain a valid grid diagram.
+	inline std::vector<BatchJob> load_batch_jobs(const std::vector<std::string>& csvs, size_t number_of_threads = 0)
+	{
+		std::vector<BatchJob> jobs(csvs.size());
+		// Not a `std::vector<bool>`, since each worker writes to its own element
+		std::vector<uint8_t> is_valid(csvs.size(), 0);
+
+		{
+			utils::ThreadPool pool{ number_of_threads == 0 ? std::thread::hardware_concurrency() : number_of_threads };
+
+			for (size_t i = 0; i < csvs.size(); ++i)
+			{
+				pool.submit([&, i] {
+					try
+					{
+						const auto diagram = Diagram{ csvs[i] };
+						jobs[i] = BatchJob{ csvs[i], diagram.generate_curve() };
+						is_valid[i] = 1;
+					}
+					catch (const std::exception& e)
+					{
+						std::cerr << "Skipping " << csvs[i] << ": " << e.what() << std::endl;
+					}
+				});
+			}
+			pool.wait();
+		}
+
+		std::vector<BatchJob> valid;
+		for (size_t i = 0; i < jobs.size(); ++i)
+		{
+			if (is_valid[i])
+			{
+				valid.push_back(std::move(jobs[i]));
+			}
+		}
+
+		return valid;
+	}
+
+}
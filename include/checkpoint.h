@@ -0,0 +1,325 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "knot.h"
+
+namespace knot
+{
+
+	/// Saves and restores the complete state of a `Knot` (bead positions, velocities, anchors, simulation
+	/// parameters, etc.) to and from a compact binary file, so that long relaxations can be stopped and resumed
+	/// later on without changing the outcome: a restored knot continues exactly (bit for bit) where the original
+	/// left off
+	///
+	/// Layout (all values are stored in the machine's native byte order):
+	///
+	///		magic ("GKCP"), version (u32), source (u64)
+	///		simulation parameters
+	///		number of steps (u64), steps since last resample (u64)
+	///		number of vertices `n` (u64)
+	///		anchors (n * vec3), rope (n * vec3)
+	///		beads (n * { prev_position, position, velocity, acceleration, index, neighbor_l_index, neighbor_r_index, is_stuck })
+	///
+	/// Floats are stored as raw 32-bit values and indices as 64-bit values. Anything that can be derived from
+	/// the above (the selected force law, the neighbor lists) is rebuilt after loading. The source is a hash of the
+	/// curve that the knot started out as (see `get_source_hash`), so that a checkpoint is never resumed by a
+	/// different job than the one that wrote it. Since the simulation uses
+	/// the restored indices directly, a checkpoint whose counts, indices or enums are out of range is rejected
+	/// (with a `std::runtime_error`) rather than loaded.
+	class Checkpoint
+	{
+
+	public:
+
+		/// Returns the FNV-1a hash of `size` bytes at `data`.
+		static uint64_t hash_bytes(const void* data, size_t size)
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash = (hash ^ static_cast<const unsigned char*>(data)[i]) * 1099511628211ull;
+			}
+
+			return hash;
+		}
+
+		/// Returns a hash of the vertices of `curve`, which identifies the curve that a checkpointed knot started out as.
+		static uint64_t get_source_hash(const geom::PolygonalCurve& curve)
+		{
+			const auto& vertices = curve.get_vertices();
+			return hash_bytes(vertices.data(), vertices.size() * sizeof(glm::vec3));
+		}
+
+		/// Atomically writes the state of `knot` (which started out as the curve with the hash `source`) to `path`: 
+		/// the checkpoint is written to a temporary file first and then renamed, so `path` always contains either the 
+		/// old or the new checkpoint (never a partially written one), even if the process is killed part-way through.
+		static void save(const Knot& knot, const std::string& path, uint64_t source = 0)
+		{
+			const auto temporary_path = path + ".tmp";
+
+			{
+				std::ofstream file{ temporary_path, std::ios::binary | std::ios::trunc };
+				if (!file.is_open())
+				{
+					throw std::runtime_error("Unable to open checkpoint file for writing: " + temporary_path);
+				}
+
+				write(file, knot, source);
+
+				file.flush();
+				if (!file)
+				{
+					throw std::runtime_error("Failed to write checkpoint file: " + temporary_path);
+				}
+			}
+
+			std::filesystem::rename(temporary_path, path);
+		}
+
+		/// Restores a knot from the checkpoint at `path`. If `source` is given, the checkpoint must have been saved
+		/// with the same source hash.
+		static Knot load(const std::string& path, std::optional<uint64_t> source = std::nullopt)
+		{
+			std::ifstream file{ path, std::ios::binary };
+			if (!file.is_open())
+			{
+				throw std::runtime_error("Unable to open checkpoint file: " + path);
+			}
+
+			return read(file, source);
+		}
+
+		/// Writes the state of `knot` to an (already opened) binary stream.
+		static void write(std::ostream& stream, const Knot& knot, uint64_t source = 0)
+		{
+			stream.write(magic, sizeof(magic));
+			write_value(stream, version);
+			write_value(stream, source);
+
+			write_params(stream, knot.params);
+
+			write_value(stream, static_cast<uint64_t>(knot.number_of_steps));
+			write_value(stream, static_cast<uint64_t>(knot.steps_since_resample));
+			write_value(stream, static_cast<uint64_t>(knot.beads.size()));
+
+			write_vertices(stream, knot.anchors.get_vertices());
+			write_vertices(stream, knot.rope.get_vertices());
+
+			for (const auto& bead : knot.beads)
+			{
+				write_vec3(stream, bead.prev_position);
+				write_vec3(stream, bead.position);
+				write_vec3(stream, bead.velocity);
+				write_vec3(stream, bead.acceleration);
+				write_value(stream, static_cast<uint64_t>(bead.index));
+				write_value(stream, static_cast<uint64_t>(bead.neighbor_l_index));
+				write_value(stream, static_cast<uint64_t>(bead.neighbor_r_index));
+				write_value(stream, static_cast<uint8_t>(bead.is_stuck ? 1 : 0));
+			}
+		}
+
+		/// Reads a knot from an (already opened) binary stream.
+		static Knot read(std::istream& stream, std::optional<uint64_t> source = std::nullopt)
+		{
+			char header[sizeof(magic)];
+			stream.read(header, sizeof(header));
+			if (!stream || !std::equal(std::begin(header), std::end(header), std::begin(magic)))
+			{
+				throw std::runtime_error("Not a knot checkpoint file");
+			}
+
+			if (read_value<uint32_t>(stream) != version)
+			{
+				throw std::runtime_error("Unsupported knot checkpoint version");
+			}
+
+			if (const auto stored_source = read_value<uint64_t>(stream); source && *source != stored_source)
+			{
+				throw std::runtime_error("Knot checkpoint was saved from a different curve");
+			}
+
+			const auto params = read_params(stream);
+			const auto number_of_steps = read_value<uint64_t>(stream);
+			const auto steps_since_resample = read_value<uint64_t>(stream);
+			const auto number_of_vertices = read_value<uint64_t>(stream);
+
+			// Each vertex takes up a fixed number of bytes in the rest of the file, so a count that couldn't possibly
+			// fit is corrupt (and would otherwise be used to reserve memory)
+			if (number_of_vertices > get_remaining_bytes(stream) / bytes_per_vertex)
+			{
+				throw std::runtime_error("Invalid number of vertices in knot checkpoint");
+			}
+
+			const auto anchors = read_vertices(stream, number_of_vertices);
+			const auto rope = read_vertices(stream, number_of_vertices);
+
+			auto knot = Knot{ geom::PolygonalCurve{ anchors }, params };
+			knot.rope.set_vertices(rope);
+			knot.number_of_steps = number_of_steps;
+			knot.steps_since_resample = steps_since_resample;
+
+			for (auto& bead : knot.beads)
+			{
+				bead.prev_position = read_vec3(stream);
+				bead.position = read_vec3(stream);
+				bead.velocity = read_vec3(stream);
+				bead.acceleration = read_vec3(stream);
+				bead.index = read_value<uint64_t>(stream);
+				bead.neighbor_l_index = read_value<uint64_t>(stream);
+				bead.neighbor_r_index = read_value<uint64_t>(stream);
+				bead.is_stuck = read_value<uint8_t>(stream) != 0;
+
+				if (bead.index >= number_of_vertices || bead.neighbor_l_index >= number_of_vertices || bead.neighbor_r_index >= number_of_vertices)
+				{
+					throw std::runtime_error("Invalid bead index in knot checkpoint");
+				}
+			}
+
+			return knot;
+		}
+
+	private:
+
+		static constexpr char magic[4] = { 'G', 'K', 'C', 'P' };
+		static constexpr uint32_t version = 2;
+
+		// The number of bytes that each vertex takes up: its anchor and rope positions, and its bead
+		static constexpr uint64_t bytes_per_vertex = 2 * 3 * sizeof(float) + 4 * 3 * sizeof(float) + 3 * sizeof(uint64_t) + sizeof(uint8_t);
+
+		/// Returns the number of bytes between the current position of `stream` and its end, or (if the stream
+		/// can't seek) an upper bound on the size of any reasonable checkpoint.
+		static uint64_t get_remaining_bytes(std::istream& stream)
+		{
+			const auto position = stream.tellg();
+			if (position == std::istream::pos_type(-1))
+			{
+				return uint64_t{ 1 } << 40;
+			}
+
+			stream.seekg(0, std::ios::end);
+			const auto end = stream.tellg();
+			stream.seekg(position);
+
+			if (!stream || end == std::istream::pos_type(-1))
+			{
+				throw std::runtime_error("Unable to read knot checkpoint");
+			}
+
+			return static_cast<uint64_t>(end - position);
+		}
+
+		template<typename T>
+		static void write_value(std::ostream& stream, T value)
+		{
+			stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		template<typename T>
+		static T read_value(std::istream& stream)
+		{
+			T value;
+			stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+
+			if (!stream)
+			{
+				throw std::runtime_error("Unexpected end of knot checkpoint");
+			}
+
+			return value;
+		}
+
+		static void write_vec3(std::ostream& stream, const glm::vec3& value)
+		{
+			write_value(stream, value.x);
+			write_value(stream, value.y);
+			write_value(stream, value.z);
+		}
+
+		static glm::vec3 read_vec3(std::istream& stream)
+		{
+			const auto x = read_value<float>(stream);
+			const auto y = read_value<float>(stream);
+			const auto z = read_value<float>(stream);
+
+			return { x, y, z };
+		}
+
+		static void write_vertices(std::ostream& stream, const std::vector<glm::vec3>& vertices)
+		{
+			for (const auto& vertex : vertices)
+			{
+				write_vec3(stream, vertex);
+			}
+		}
+
+		static std::vector<glm::vec3> read_vertices(std::istream& stream, size_t number_of_vertices)
+		{
+			std::vector<glm::vec3> vertices;
+			vertices.reserve(number_of_vertices);
+
+			for (size_t i = 0; i < number_of_vertices; ++i)
+			{
+				vertices.push_back(read_vec3(stream));
+			}
+
+			return vertices;
+		}
+
+		static void write_params(std::ostream& stream, const SimulationParams& params)
+		{
+			write_value(stream, params.starting_length);
+			write_value(stream, params.d_max);
+			write_value(stream, params.d_close);
+			write_value(stream, params.mass);
+			write_value(stream, params.damping);
+			write_value(stream, params.anchor_weight);
+			write_value(stream, params.beta);
+			write_value(stream, params.h);
+			write_value(stream, params.alpha);
+			write_value(stream, params.k);
+			write_value(stream, params.epsilon);
+			write_value(stream, params.repulsion_cutoff);
+			write_value(stream, params.skin);
+			write_value(stream, static_cast<uint32_t>(params.collision_response));
+			write_value(stream, static_cast<uint64_t>(params.collision_iterations));
+			write_value(stream, static_cast<uint64_t>(params.resample_interval));
+		}
+
+		static SimulationParams read_params(std::istream& stream)
+		{
+			SimulationParams params;
+			params.starting_length = read_value<float>(stream);
+			params.d_max = read_value<float>(stream);
+			params.d_close = read_value<float>(stream);
+			params.mass = read_value<float>(stream);
+			params.damping = read_value<float>(stream);
+			params.anchor_weight = read_value<float>(stream);
+			params.beta = read_value<float>(stream);
+			params.h = read_value<float>(stream);
+			params.alpha = read_value<float>(stream);
+			params.k = read_value<float>(stream);
+			params.epsilon = read_value<float>(stream);
+			params.repulsion_cutoff = read_value<float>(stream);
+			params.skin = read_value<float>(stream);
+			const auto collision_response = read_value<uint32_t>(stream);
+			if (collision_response > static_cast<uint32_t>(CollisionResponse::ADVANCE))
+			{
+				throw std::runtime_error("Invalid collision response in knot checkpoint");
+			}
+			params.collision_response = static_cast<CollisionResponse>(collision_response);
+			params.collision_iterations = read_value<uint64_t>(stream);
+			params.resample_interval = read_value<uint64_t>(stream);
+
+			return params;
+		}
+
+	};
+
+}
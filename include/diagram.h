@@ -3,10 +3,12 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory_resource>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "arena.h"
 #include "polygonal_curve.h"
 
 namespace knot
@@ -95,6 +97,11 @@ namespace knot
 			std::ifstream file;
 			file.open(from_csv);
 
+			if (!file.is_open())
+			{
+				throw std::runtime_error("Unable to open grid diagram file: " + from_csv);
+			}
+
 			// Count the number of lines in the file
 			const auto number_of_lines = std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n') + 1;
 			std::cout << "File contains " << number_of_lines << " lines" << std::endl;
@@ -452,6 +459,41 @@ namespace knot
 			return col;
 		}
 
+		/// Writes this diagram to `stream` in the same .csv format that it can be loaded from
+		void write_csv(std::ostream& stream) const
+		{
+			for (const auto& row : data)
+			{
+				for (size_t j = 0; j < row.size(); ++j)
+				{
+					stream << (row[j] == Entry::X ? "x" : row[j] == Entry::O ? "o" : " ");
+					if (j != row.size() - 1)
+					{
+						stream << ",";
+					}
+				}
+				stream << "\n";
+			}
+		}
+
+		/// Writes this diagram to the .csv file at `path` (see `write_csv`)
+		void save_csv(const std::string& path) const
+		{
+			std::ofstream file{ path, std::ios::trunc };
+			if (!file.is_open())
+			{
+				throw std::runtime_error("Unable to open file for writing: " + path);
+			}
+
+			write_csv(file);
+
+			file.flush();
+			if (!file)
+			{
+				throw std::runtime_error("Failed to write file: " + path);
+			}
+		}
+
 		/// Finds the indices of the `x` / `o` that occur in the specified row (or col)
 		std::pair<size_t, size_t> find_indices_of_xo(Axis axis, size_t index) const
 		{
@@ -463,15 +505,18 @@ namespace knot
 		/// Finds the index of the first occurence of `entry` in the specified row (or col)
 		size_t find_index_of_first(Axis axis, size_t index, Entry entry) const
 		{
+			validate_index(index);
+
+			// Search the grid in place, rather than copying the row (or col) out of it first
 			if (axis == Axis::ROW)
 			{
-				const auto row = get_row(index);
+				const auto& row = data[index];
 				return std::distance(row.begin(), std::find(row.begin(), row.end(), entry));
 			}
 			else
 			{
-				const auto col = get_col(index);
-				return std::distance(col.begin(), std::find(col.begin(), col.end(), entry));
+				const auto row = std::find_if(data.begin(), data.end(), [&](const auto& row) { return row[index] == entry; });
+				return std::distance(data.begin(), row);
 			}
 		}
 
@@ -525,6 +570,14 @@ namespace knot
 
 		/// Generates a polygonal curve (polyline) that represents the topological structure of this grid diagram
 		geom::PolygonalCurve generate_curve() const override
+		{
+			utils::Arena scratch;
+			return generate_curve(&scratch);
+		}
+
+		/// Same as `generate_curve()`, but all of the temporaries (the path through the grid and the crossings along
+		/// each column) are allocated from `scratch` (for example, a per-frame `utils::Arena`)
+		geom::PolygonalCurve generate_curve(std::pmr::memory_resource* scratch) const
 		{
 			// First, get the row or column corresponding to the index where the last
 			// row or column ended
@@ -540,11 +593,11 @@ namespace knot
 			auto tie = s;
 
 			// Absolute indices of all of the grid cells that form the "path" of this knot
-			std::vector<size_t> indices = 
+			std::pmr::vector<size_t> indices(
 			{
 				convert_to_absolute_index(s, 0),
 				convert_to_absolute_index(e, 0)
-			};
+			}, scratch);
 
 			bool keep_going = true;
 			bool traverse_horizontal = true;
@@ -593,8 +646,8 @@ namespace knot
 
 			// If we want to traverse just rows or just columns, we can simply use the underlying knot
 			// topology and ignore either the first or last element
-			auto rows = indices;
-			auto cols = indices;
+			std::pmr::vector<size_t> rows(indices, scratch);
+			std::pmr::vector<size_t> cols(indices, scratch);
 			rows.erase(rows.begin());
 			cols.pop_back();
 
@@ -609,7 +662,10 @@ namespace knot
 			// Find crossings: rows pass under any columns that they intersect, so we will
 			// add additional vertex (or vertices) to any column that contains a intersection(s)
 			// and "lift" this vertex (or vertices) along the z-axis
-			std::vector<size_t> lifted;
+			std::pmr::vector<size_t> lifted{ scratch };
+
+			// A list of all intersections along the current column (reused for each one)
+			std::pmr::vector<std::pair<size_t, size_t>> intersections{ scratch };
 
 			const auto num_col_chunks = static_cast<size_t>(cols.size() / 2);
 			const auto num_row_chunks = static_cast<size_t>(rows.size() / 2);
@@ -633,8 +689,7 @@ namespace knot
 				const auto [cs_i, cs_j] = convert_to_grid_indices(col_s);
 				const auto [ce_i, ce_j] = convert_to_grid_indices(col_e);
 
-				// A list of all intersections along this column
-				std::vector<std::pair<size_t, size_t>> intersections;
+				intersections.clear();
 
 				for (size_t j = 0; j < num_row_chunks; ++j)
 				{
@@ -855,6 +910,11 @@ namespace knot
 
 		void validate() const
 		{
+			if (data.empty())
+			{
+				throw std::runtime_error("Invalid grid diagram - the grid is empty");
+			}
+
 			for (size_t i = 0; i < data.size(); ++i)
 			{
 				const auto row = get_row(i);
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "diagram.h"
+
+namespace knot
+{
+
+	/// Generators for whole families of grid diagrams, which can be made arbitrarily large (e.g. for measuring how
+	/// the rest of the program scales with the grid number)
+	///
+	/// Every generator works on the columns of the `x` and `o` in each row (rather than on a `Diagram`, whose moves
+	/// copy rows and columns around), so that grids with thousands of rows can be built quickly. Random generators
+	/// take an explicit seed and only use the raw output of `std::mt19937_64` (which, unlike the standard
+	/// distributions, is the same on every platform), so the same seed always produces the same diagram.
+	namespace families
+	{
+
+		/// The column of the `x` and the column of the `o` in each row of a grid diagram
+		struct Markers
+		{
+			std::vector<size_t> x;
+			std::vector<size_t> o;
+
+			size_t get_size() const
+			{
+				return x.size();
+			}
+		};
+
+		inline Markers to_markers(const Diagram& diagram)
+		{
+			Markers markers;
+			for (size_t i = 0; i < diagram.get_size(); ++i)
+			{
+				const auto [x, o] = diagram.find_indices_of_xo(Axis::ROW, i);
+				markers.x.push_back(x);
+				markers.o.push_back(o);
+			}
+
+			return markers;
+		}
+
+		inline Diagram to_diagram(const Markers& markers)
+		{
+			const auto size = markers.get_size();
+
+			std::vector<std::vector<Entry>> data(size, std::vector<Entry>(size, Entry::BLANK));
+			for (size_t i = 0; i < size; ++i)
+			{
+				data[i][markers.x[i]] = Entry::X;
+				data[i][markers.o[i]] = Entry::O;
+			}
+
+			return Diagram{ data };
+		}
+
+		namespace detail
+		{
+
+			/// Returns a (nearly) uniform random integer in [0, bound).
+			inline size_t get_random_index(std::mt19937_64& rng, size_t bound)
+			{
+				return static_cast<size_t>(rng() % bound);
+			}
+
+			/// Cyclically translates every marker by `rows` rows (downwards) and `cols` columns (to the right).
+			inline Markers translate(const Markers& markers, size_t rows, size_t cols)
+			{
+				const auto size = markers.get_size();
+
+				Markers translated{ std::vector<size_t>(size), std::vector<size_t>(size) };
+				for (size_t i = 0; i < size; ++i)
+				{
+					translated.x[(i + rows) % size] = (markers.x[i] + cols) % size;
+					translated.o[(i + rows) % size] = (markers.o[i] + cols) % size;
+				}
+
+				return translated;
+			}
+
+		}
+
+		/// The torus knot (or link, if `p` and `q` aren't coprime) T(p, q), on a grid of size p + q: the `x` in each
+		/// row is on the diagonal, and the `o` is `p` columns to its right (wrapping around).
+		inline Diagram torus(size_t p, size_t q)
+		{
+			if (p == 0 || q == 0)
+			{
+				throw std::invalid_argument("Torus knots need p > 0 and q > 0");
+			}
+
+			const auto size = p + q;
+
+			Markers markers;
+			for (size_t i = 0; i < size; ++i)
+			{
+				markers.x.push_back(i);
+				markers.o.push_back((i + p) % size);
+			}
+
+			return to_diagram(markers);
+		}
+
+		/// The twist knot with `n` half-twists (the unknot, trefoil, figure-eight, 5_2, 6_1, ...), on a grid of size
+		/// n + 4 (its arc index).
+		///
+		/// The first `n` rows form a staircase of two anti-parallel strands, which twist around each other once per
+		/// row, and the last four rows close them off with a clasp. Which way the clasp is hooked depends on the
+		/// orientation of the strands as they leave the staircase, i.e. on whether `n` is even or odd.
+		inline Diagram twist(size_t n)
+		{
+			const auto size = n + 4;
+
+			Markers markers{ std::vector<size_t>(size), std::vector<size_t>(size) };
+			const auto set = [&](size_t row, size_t x, size_t o, bool flip) {
+				markers.x[row] = flip ? o : x;
+				markers.o[row] = flip ? x : o;
+			};
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				set(i, i, i + 2, i % 2 == 1);
+			}
+
+			const auto odd = n % 2 == 1;
+			set(n + 0, n + 0, n + 3, odd);
+			set(n + 1, n + 2, 0, false);
+			set(n + 2, n + 3, n + 1, odd);
+			set(n + 3, 1, n + 2, false);
+
+			return to_diagram(markers);
+		}
+
+		/// A random grid diagram of the given size, made from a pair of random permutations (the columns of the
+		/// `x`s and the `o`s).
+		///
+		/// Following a strand from the vertical segment in column `c` leads to the vertical segment in column
+		/// `σ^-1(c)`, where `σ` is the permutation that maps the `x` in each row to the `o` in the same row. If
+		/// `single_component` is `true`, `σ` is drawn from the n-cycles (with Sattolo's algorithm), so the diagram is
+		/// always a knot. Otherwise, `σ` is any permutation without fixed points, and the diagram is usually a link.
+		inline Diagram random(size_t size, uint64_t seed, bool single_component = true)
+		{
+			if (size < 2)
+			{
+				throw std::invalid_argument("Random grid diagrams must have at least 2 rows");
+			}
+
+			std::mt19937_64 rng{ seed };
+
+			std::vector<size_t> columns(size);
+			std::iota(columns.begin(), columns.end(), 0);
+			for (size_t i = size - 1; i > 0; --i)
+			{
+				std::swap(columns[i], columns[detail::get_random_index(rng, i + 1)]);
+			}
+
+			std::vector<size_t> sigma(size);
+			std::iota(sigma.begin(), sigma.end(), 0);
+			if (single_component)
+			{
+				for (size_t i = size - 1; i > 0; --i)
+				{
+					std::swap(sigma[i], sigma[detail::get_random_index(rng, i)]);
+				}
+			}
+			else
+			{
+				// Rejection sampling: roughly 1 in e permutations has no fixed points
+				const auto has_fixed_point = [&] {
+					for (size_t i = 0; i < size; ++i)
+					{
+						if (sigma[i] == i)
+						{
+							return true;
+						}
+					}
+					return false;
+				};
+
+				do
+				{
+					for (size_t i = size - 1; i > 0; --i)
+					{
+						std::swap(sigma[i], sigma[detail::get_random_index(rng, i + 1)]);
+					}
+				} while (has_fixed_point());
+			}
+
+			Markers markers;
+			for (size_t i = 0; i < size; ++i)
+			{
+				markers.x.push_back(columns[i]);
+				markers.o.push_back(sigma[columns[i]]);
+			}
+
+			return to_diagram(markers);
+		}
+
+		/// The connected sum of two grid diagrams, on a grid of size a + b - 1.
+		///
+		/// `a` is translated so that it has an `x` in its bottom-right corner, and `b` so that it has an `o` in its
+		/// top-left corner. The two grids are then overlapped at these corners, and both markers are removed: the
+		/// row and column that they shared join a strand of `a` to a strand of `b` (with a single, nugatory crossing
+		/// between them).
+		inline Diagram connected_sum(const Diagram& a, const Diagram& b)
+		{
+			const auto size_a = a.get_size();
+			const auto size_b = b.get_size();
+
+			auto markers_a = to_markers(a);
+			markers_a = detail::translate(markers_a, 0, size_a - 1 - markers_a.x[0]);
+			markers_a = detail::translate(markers_a, size_a - 1, 0);
+
+			auto markers_b = to_markers(b);
+			markers_b = detail::translate(markers_b, 0, size_b - markers_b.o[0]);
+
+			const auto offset = size_a - 1;
+
+			Markers markers;
+			for (size_t i = 0; i < offset; ++i)
+			{
+				markers.x.push_back(markers_a.x[i]);
+				markers.o.push_back(markers_a.o[i]);
+			}
+
+			// The shared row keeps the `o` of `a` and the `x` of `b`
+			markers.x.push_back(markers_b.x[0] + offset);
+			markers.o.push_back(markers_a.o[offset]);
+
+			for (size_t i = 1; i < size_b; ++i)
+			{
+				markers.x.push_back(markers_b.x[i] + offset);
+				markers.o.push_back(markers_b.o[i] + offset);
+			}
+
+			return to_diagram(markers);
+		}
+
+		/// Applies `count` stabilizations to `diagram`, each at a random marker and in a random direction, which
+		/// grows the grid by `count` without changing the knot.
+		///
+		/// A stabilization replaces a marker with a 2x2 block (one new row and one new column, on either side of
+		/// the marker's row and column) that contains the same marker on two opposite corners and the other kind of
+		/// marker on the corner in the new row and the new column.
+		inline Diagram stabilize(const Diagram& diagram, size_t count, uint64_t seed)
+		{
+			std::mt19937_64 rng{ seed };
+
+			auto markers = to_markers(diagram);
+			for (size_t k = 0; k < count; ++k)
+			{
+				const auto size = markers.get_size();
+				const auto row = detail::get_random_index(rng, size);
+				const auto choice = detail::get_random_index(rng, 8);
+				const bool is_x = choice & 1;
+				const bool below = choice & 2;
+				const bool right = choice & 4;
+
+				auto& same = is_x ? markers.x : markers.o;
+				auto& other = is_x ? markers.o : markers.x;
+				const auto col = same[row];
+
+				// The indices of the old row / column after the new one has been inserted, and of the new one
+				const auto new_row = below ? row + 1 : row;
+				const auto old_row = below ? row : row + 1;
+				const auto new_col = right ? col + 1 : col;
+				const auto old_col = right ? col : col + 1;
+
+				for (size_t i = 0; i < size; ++i)
+				{
+					if (markers.x[i] >= new_col) markers.x[i]++;
+					if (markers.o[i] >= new_col) markers.o[i]++;
+				}
+
+				same.insert(same.begin() + new_row, old_col);
+				other.insert(other.begin() + new_row, new_col);
+				same[old_row] = new_col;
+			}
+
+			return to_diagram(markers);
+		}
+
+	}
+
+}
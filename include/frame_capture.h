@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <mutex>
+
+#include "glad/glad.h"
+
+#include "gpu_buffer.h"
+#include "image_writer.h"
+#include "thread_pool.h"
+
+namespace graphics
+{
+
+    /// Reads rendered frames back from the GPU without stalling the pipeline, and hands them to a callback on a
+    /// background thread (e.g. to be written to disk)
+    ///
+    /// Readbacks are double-buffered through a pair of pixel buffer objects: each call to `capture` starts an
+    /// asynchronous copy of the framebuffer into one of them and then collects the frame that was started on the
+    /// previous call, which the GPU has (almost always) finished with by then. Frames are delivered in order, from
+    /// a single writer thread, with at most `max_frames_in_flight` of them waiting to be written at once (after
+    /// which `capture` blocks, so a slow disk can't use up all of the memory).
+    class FrameCapture
+    {
+    public:
+
+        /// Called (on the writer thread) with the index of each frame, in order
+        using Sink = std::function<void(size_t frame_index, const utils::Image& image)>;
+
+        FrameCapture(uint32_t width, uint32_t height, Sink sink, size_t max_frames_in_flight = 4) :
+            width{ width },
+            height{ height },
+            sink{ sink },
+            max_frames_in_flight{ max_frames_in_flight },
+            writer{ 1 }
+        {
+            for (auto& buffer : buffers)
+            {
+                buffer = create_buffer();
+                glNamedBufferData(buffer, get_frame_size(), nullptr, GL_STREAM_READ);
+            }
+        }
+
+        FrameCapture(const FrameCapture& other) = delete;
+
+        FrameCapture& operator=(const FrameCapture& other) = delete;
+
+        ~FrameCapture()
+        {
+            finish();
+
+            for (auto& buffer : buffers)
+            {
+                delete_buffer(buffer);
+            }
+        }
+
+        /// Starts reading back the first color attachment of `framebuffer`, then collects the previous frame.
+        void capture(uint32_t framebuffer)
+        {
+            glNamedFramebufferReadBuffer(framebuffer, GL_COLOR_ATTACHMENT0);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[current]);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+            fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            current = (current + 1) % buffers.size();
+
+            // The other buffer holds the previous frame (if any)
+            collect(current);
+        }
+
+        /// Collects any outstanding frame and blocks until every frame has been handed to the sink.
+        void finish()
+        {
+            // `current` is the oldest buffer
+            collect(current);
+            collect((current + 1) % buffers.size());
+            writer.wait();
+        }
+
+        /// Returns the number of frames that have been collected so far.
+        size_t get_number_of_frames() const
+        {
+            return number_of_frames;
+        }
+
+    private:
+
+        uint32_t width;
+        uint32_t height;
+        Sink sink;
+        size_t max_frames_in_flight;
+
+        std::array<uint32_t, 2> buffers;
+        std::array<GLsync, 2> fences = {};
+        size_t current = 0;
+        size_t number_of_frames = 0;
+
+        // Guards `frames_in_flight`
+        std::mutex mutex;
+        std::condition_variable frame_written;
+        size_t frames_in_flight = 0;
+
+        // A single worker, so that frames are written in order (declared last, so that it's destroyed first)
+        utils::ThreadPool writer;
+
+        size_t get_frame_size() const
+        {
+            return static_cast<size_t>(width) * height * 4;
+        }
+
+        void collect(size_t index)
+        {
+            if (fences[index] == nullptr)
+            {
+                return;
+            }
+
+            glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fences[index]);
+            fences[index] = nullptr;
+
+            // Copy the pixels out (flipping them, since OpenGL's first row is the bottom one) so that the buffer can
+            // be reused right away
+            utils::Image image{ width, height, std::vector<uint8_t>(get_frame_size()) };
+
+            const auto row_size = static_cast<size_t>(width) * 4;
+            const auto pixels = static_cast<const uint8_t*>(glMapNamedBufferRange(buffers[index], 0, get_frame_size(), GL_MAP_READ_BIT));
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                std::memcpy(&image.pixels[y * row_size], pixels + (height - 1 - y) * row_size, row_size);
+            }
+            glUnmapNamedBuffer(buffers[index]);
+
+            {
+                std::unique_lock<std::mutex> lock{ mutex };
+                frame_written.wait(lock, [this] { return frames_in_flight < max_frames_in_flight; });
+                frames_in_flight++;
+            }
+
+            const auto frame_index = number_of_frames++;
+            writer.submit([this, frame_index, image = std::move(image)] {
+                try
+                {
+                    sink(frame_index, image);
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "Failed to write frame " << frame_index << ": " << e.what() << std::endl;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock{ mutex };
+                    frames_in_flight--;
+                }
+                frame_written.notify_one();
+            });
+        }
+    };
+
+}
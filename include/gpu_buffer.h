@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "glad/glad.h"
+
+namespace graphics
+{
+
+    /// Running totals of the GPU objects that have been created and destroyed (and the uploads that have been
+    /// made) through the helpers below: any objects that are still alive when the program shuts down have leaked
+    struct ResourceCounters
+    {
+        size_t buffers_created = 0;
+        size_t buffers_deleted = 0;
+        size_t vertex_arrays_created = 0;
+        size_t vertex_arrays_deleted = 0;
+
+        // The number of times that a buffer's storage was reallocated because it was too small
+        size_t reallocations = 0;
+
+        // The number of times that a buffer's storage was orphaned (i.e. replaced with fresh storage of the same size)
+        size_t orphans = 0;
+
+        // The total number of bytes that have been uploaded
+        size_t bytes_uploaded = 0;
+
+        size_t get_live_buffers() const
+        {
+            return buffers_created - buffers_deleted;
+        }
+
+        size_t get_live_vertex_arrays() const
+        {
+            return vertex_arrays_created - vertex_arrays_deleted;
+        }
+
+        /// Prints a warning for each kind of object that is still alive, and returns `true` if there were any.
+        bool report_leaks(std::ostream& stream = std::cerr) const
+        {
+            if (get_live_buffers() > 0)
+            {
+                stream << "Warning: " << get_live_buffers() << " GPU buffer(s) were never deleted\n";
+            }
+            if (get_live_vertex_arrays() > 0)
+            {
+                stream << "Warning: " << get_live_vertex_arrays() << " vertex array(s) were never deleted\n";
+            }
+
+            return get_live_buffers() > 0 || get_live_vertex_arrays() > 0;
+        }
+    };
+
+    /// Returns the counters that are shared by every GPU object wrapper in the program.
+    inline ResourceCounters& get_resource_counters()
+    {
+        static ResourceCounters counters;
+        return counters;
+    }
+
+    inline uint32_t create_buffer()
+    {
+        uint32_t buffer_id;
+        glCreateBuffers(1, &buffer_id);
+        get_resource_counters().buffers_created++;
+
+        return buffer_id;
+    }
+
+    inline void delete_buffer(uint32_t& buffer_id)
+    {
+        if (buffer_id != 0)
+        {
+            glDeleteBuffers(1, &buffer_id);
+            get_resource_counters().buffers_deleted++;
+            buffer_id = 0;
+        }
+    }
+
+    inline uint32_t create_vertex_array()
+    {
+        uint32_t vertex_array_id;
+        glCreateVertexArrays(1, &vertex_array_id);
+        get_resource_counters().vertex_arrays_created++;
+
+        return vertex_array_id;
+    }
+
+    inline void delete_vertex_array(uint32_t& vertex_array_id)
+    {
+        if (vertex_array_id != 0)
+        {
+            glDeleteVertexArrays(1, &vertex_array_id);
+            get_resource_counters().vertex_arrays_deleted++;
+            vertex_array_id = 0;
+        }
+    }
+
+    /// Returns the capacity that a buffer with capacity `capacity` should grow to in order to hold `required`
+    /// bytes: the capacity is doubled until it is large enough, so a buffer that keeps growing only needs to be
+    /// reallocated a logarithmic number of times.
+    inline size_t grow_capacity(size_t capacity, size_t required)
+    {
+        capacity = std::max(capacity, size_t{ 256 });
+        while (capacity < required)
+        {
+            capacity *= 2;
+        }
+
+        return capacity;
+    }
+
+    /// A GPU buffer (with mutable storage) whose contents are replaced wholesale every now and then (e.g. whenever
+    /// the topology of the knot changes), which keeps the same buffer object alive for its entire lifetime
+    ///
+    /// When new data fits within the current capacity, the old storage is orphaned (so the driver can hand out
+    /// fresh memory instead of waiting for any draw calls that still read from it) and the data is uploaded with
+    /// a single sub-data call. Otherwise, the storage grows (see `grow_capacity`). Either way, the handle stays
+    /// the same, so vertex array bindings never need to be updated.
+    class GrowableBuffer
+    {
+    public:
+
+        GrowableBuffer(GLenum usage = GL_DYNAMIC_DRAW) :
+            buffer_id{ create_buffer() },
+            usage{ usage }
+        {}
+
+        GrowableBuffer(const GrowableBuffer& other) = delete;
+
+        GrowableBuffer& operator=(const GrowableBuffer& other) = delete;
+
+        ~GrowableBuffer()
+        {
+            delete_buffer(buffer_id);
+        }
+
+        uint32_t get_handle() const
+        {
+            return buffer_id;
+        }
+
+        /// Returns the number of bytes that were uploaded most recently.
+        size_t get_size() const
+        {
+            return size;
+        }
+
+        /// Returns the number of bytes that this buffer can hold before it needs to grow.
+        size_t get_capacity() const
+        {
+            return capacity;
+        }
+
+        /// Replaces the contents of this buffer with the `size` bytes at `data`.
+        void upload(const void* data, size_t size)
+        {
+            auto& counters = get_resource_counters();
+
+            if (size > capacity)
+            {
+                capacity = grow_capacity(capacity, size);
+                counters.reallocations++;
+            }
+            else
+            {
+                counters.orphans++;
+            }
+            glNamedBufferData(buffer_id, capacity, nullptr, usage);
+
+            glNamedBufferSubData(buffer_id, 0, size, data);
+            this->size = size;
+            counters.bytes_uploaded += size;
+        }
+
+        template<typename T, typename Allocator>
+        void upload(const std::vector<T, Allocator>& data)
+        {
+            upload(data.data(), sizeof(T) * data.size());
+        }
+
+    private:
+
+        uint32_t buffer_id;
+        GLenum usage;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "glad/glad.h"
+
+namespace graphics
+{
+
+    /// Measures how long the GPU spends on a span of commands (e.g. a render pass), using a `GL_TIME_ELAPSED` query
+    /// that wraps it
+    ///
+    /// Query results only become available a few frames after they are issued, so each timer cycles through a
+    /// small ring of queries and only reads back the ones that have already finished: reading a result never
+    /// stalls the pipeline, but the reported time is a couple of frames old. Elapsed-time queries can't be nested,
+    /// so only one timer can be running at any given time.
+    class GpuTimer
+    {
+    public:
+
+        /// The number of measurements that can be in flight at once
+        static constexpr size_t latency = 4;
+
+        GpuTimer()
+        {
+            glCreateQueries(GL_TIME_ELAPSED, static_cast<GLsizei>(queries.size()), queries.data());
+        }
+
+        GpuTimer(const GpuTimer& other) = delete;
+
+        GpuTimer& operator=(const GpuTimer& other) = delete;
+
+        ~GpuTimer()
+        {
+            glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+        }
+
+        /// Starts timing the commands that follow.
+        void begin()
+        {
+            // If the oldest measurement still hasn't finished, its query is reused (and its result is dropped)
+            glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+        }
+
+        /// Stops timing, then reads back any measurements that have finished.
+        void end()
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            pending[current] = true;
+            current = (current + 1) % latency;
+
+            collect();
+        }
+
+        /// Returns the most recent measurement (in milliseconds).
+        float get_milliseconds() const
+        {
+            return milliseconds;
+        }
+
+        /// Returns `true` if at least one measurement has been read back.
+        bool has_result() const
+        {
+            return has_measurement;
+        }
+
+    private:
+
+        std::array<uint32_t, latency> queries;
+        std::array<bool, latency> pending = {};
+        size_t current = 0;
+
+        float milliseconds = 0.0f;
+        bool has_measurement = false;
+
+        void collect()
+        {
+            // Visit the measurements from oldest to newest, so that the latest finished one wins
+            for (size_t i = 0; i < latency; ++i)
+            {
+                const auto slot = (current + i) % latency;
+                if (!pending[slot])
+                {
+                    continue;
+                }
+
+                GLuint64 available = GL_FALSE;
+                glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (available == GL_FALSE)
+                {
+                    continue;
+                }
+
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+
+                milliseconds = static_cast<float>(elapsed) * 1e-6f;
+                has_measurement = true;
+                pending[slot] = false;
+            }
+        }
+    };
+
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace utils
+{
+
+	/// An 8-bit RGBA image, stored row by row (starting with the top row)
+	struct Image
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint8_t> pixels;
+
+		const uint8_t* get_pixel(uint32_t x, uint32_t y) const
+		{
+			return &pixels[(static_cast<size_t>(y) * width + x) * 4];
+		}
+	};
+
+	/// Writes `image` to `stream` as an 8-bit RGB .png file (the alpha channel is dropped)
+	///
+	/// The pixel data is stored uncompressed (in "stored" deflate blocks), which is much faster to write than
+	/// properly compressed data and doesn't require zlib: the files are larger, but any image tool can read them
+	/// (and re-compress them, if needed).
+	inline void write_png(std::ostream& stream, const Image& image)
+	{
+		static const auto crc_table = [] {
+			std::array<uint32_t, 256> table;
+			for (uint32_t n = 0; n < 256; ++n)
+			{
+				uint32_t c = n;
+				for (size_t k = 0; k < 8; ++k)
+				{
+					c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				}
+				table[n] = c;
+			}
+			return table;
+		}();
+
+		const auto write_u32 = [](std::vector<uint8_t>& bytes, uint32_t value) {
+			for (int shift = 24; shift >= 0; shift -= 8)
+			{
+				bytes.push_back(static_cast<uint8_t>(value >> shift));
+			}
+		};
+
+		// Each chunk is its length, its type, its data, and a CRC of the type and data
+		const auto write_chunk = [&](const char* type, const std::vector<uint8_t>& data) {
+			std::vector<uint8_t> chunk;
+			write_u32(chunk, static_cast<uint32_t>(data.size()));
+			chunk.insert(chunk.end(), type, type + 4);
+			chunk.insert(chunk.end(), data.begin(), data.end());
+
+			uint32_t crc = 0xffffffffu;
+			for (size_t i = 4; i < chunk.size(); ++i)
+			{
+				crc = crc_table[(crc ^ chunk[i]) & 0xff] ^ (crc >> 8);
+			}
+			write_u32(chunk, crc ^ 0xffffffffu);
+
+			stream.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+		};
+
+		const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		stream.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+		// Header: width, height, bit depth (8), color type (2, i.e. RGB), compression, filter, interlace
+		std::vector<uint8_t> header;
+		write_u32(header, image.width);
+		write_u32(header, image.height);
+		header.insert(header.end(), { 8, 2, 0, 0, 0 });
+		write_chunk("IHDR", header);
+
+		// The raw scanlines: each one starts with a filter type byte (0, i.e. none)
+		std::vector<uint8_t> scanlines;
+		scanlines.reserve(static_cast<size_t>(image.height) * (image.width * 3 + 1));
+		for (uint32_t y = 0; y < image.height; ++y)
+		{
+			scanlines.push_back(0);
+			for (uint32_t x = 0; x < image.width; ++x)
+			{
+				const auto pixel = image.get_pixel(x, y);
+				scanlines.insert(scanlines.end(), pixel, pixel + 3);
+			}
+		}
+
+		// Wrap the scanlines in a zlib stream made of stored blocks (at most 65535 bytes each)
+		std::vector<uint8_t> compressed = { 0x78, 0x01 };
+		const size_t max_block_size = 65535;
+		for (size_t offset = 0; offset < scanlines.size() || offset == 0; offset += max_block_size)
+		{
+			const auto block_size = std::min(max_block_size, scanlines.size() - offset);
+			const bool is_final = offset + block_size == scanlines.size();
+
+			compressed.push_back(is_final ? 1 : 0);
+			compressed.push_back(static_cast<uint8_t>(block_size));
+			compressed.push_back(static_cast<uint8_t>(block_size >> 8));
+			compressed.push_back(static_cast<uint8_t>(~block_size));
+			compressed.push_back(static_cast<uint8_t>(~block_size >> 8));
+			compressed.insert(compressed.end(), scanlines.begin() + offset, scanlines.begin() + offset + block_size);
+
+			if (is_final)
+			{
+				break;
+			}
+		}
+
+		uint32_t a = 1;
+		uint32_t b = 0;
+		for (auto byte : scanlines)
+		{
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		write_u32(compressed, (b << 16) | a);
+
+		write_chunk("IDAT", compressed);
+		write_chunk("IEND", {});
+	}
+
+	/// Writes `image` to the .png file at `path` (see above).
+	inline void save_png(const std::string& path, const Image& image)
+	{
+		std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+		if (!file.is_open())
+		{
+			throw std::runtime_error("Unable to open file for writing: " + path);
+		}
+
+		write_png(file, image);
+
+		file.flush();
+		if (!file)
+		{
+			throw std::runtime_error("Failed to write file: " + path);
+		}
+	}
+
+	/// Writes a sequence of images to a raw YUV4MPEG2 (.y4m) video stream, which video tools (e.g. ffmpeg) can
+	/// read directly
+	///
+	/// Frames are converted to full-range BT.601 YCbCr with 4:2:0 chroma subsampling (i.e. "C420jpeg"). Every
+	/// frame must have the same size as the first one.
+	class Y4MWriter
+	{
+
+	public:
+
+		Y4MWriter(std::ostream& stream, uint32_t frames_per_second = 30) :
+			stream{ stream },
+			frames_per_second{ frames_per_second }
+		{}
+
+		void write_frame(const Image& image)
+		{
+			if (number_of_frames == 0)
+			{
+				width = image.width;
+				height = image.height;
+				stream << "YUV4MPEG2 W" << width << " H" << height << " F" << frames_per_second << ":1 Ip A1:1 C420jpeg\n";
+			}
+			else if (image.width != width || image.height != height)
+			{
+				throw std::invalid_argument("Every frame of a .y4m stream must have the same size");
+			}
+
+			const auto chroma_w = (width + 1) / 2;
+			const auto chroma_h = (height + 1) / 2;
+			planes.resize(static_cast<size_t>(width) * height + static_cast<size_t>(chroma_w) * chroma_h * 2);
+
+			auto luma = planes.data();
+			auto cb = luma + static_cast<size_t>(width) * height;
+			auto cr = cb + static_cast<size_t>(chroma_w) * chroma_h;
+
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					const auto pixel = image.get_pixel(x, y);
+					luma[static_cast<size_t>(y) * width + x] = to_byte(0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2]);
+				}
+			}
+
+			// Each chroma sample is the average of (up to) a 2x2 block of pixels
+			for (uint32_t y = 0; y < chroma_h; ++y)
+			{
+				for (uint32_t x = 0; x < chroma_w; ++x)
+				{
+					float r = 0.0f;
+					float g = 0.0f;
+					float b = 0.0f;
+					float count = 0.0f;
+					for (uint32_t j = y * 2; j < std::min(y * 2 + 2, height); ++j)
+					{
+						for (uint32_t i = x * 2; i < std::min(x * 2 + 2, width); ++i)
+						{
+							const auto pixel = image.get_pixel(i, j);
+							r += pixel[0];
+							g += pixel[1];
+							b += pixel[2];
+							count += 1.0f;
+						}
+					}
+					r /= count;
+					g /= count;
+					b /= count;
+
+					cb[static_cast<size_t>(y) * chroma_w + x] = to_byte(128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b);
+					cr[static_cast<size_t>(y) * chroma_w + x] = to_byte(128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b);
+				}
+			}
+
+			stream << "FRAME\n";
+			stream.write(reinterpret_cast<const char*>(planes.data()), planes.size());
+			number_of_frames++;
+		}
+
+		size_t get_number_of_frames() const
+		{
+			return number_of_frames;
+		}
+
+	private:
+
+		std::ostream& stream;
+		uint32_t frames_per_second;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		size_t number_of_frames = 0;
+
+		// Scratch space for the Y, Cb, and Cr planes of a single frame
+		std::vector<uint8_t> planes;
+
+		static uint8_t to_byte(float value)
+		{
+			return static_cast<uint8_t>(std::clamp(value + 0.5f, 0.0f, 255.0f));
+		}
+
+	};
+
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "diagram.h"
+
+namespace knot
+{
+
+	/// Quantities that can be read off of a grid diagram without building (or relaxing) its curve
+	///
+	/// The number of components, the linking number, and the determinant are invariants of the underlying link:
+	/// they are the same for every diagram that is related by Cromwell moves. The writhe and the number of
+	/// crossings depend on the particular diagram.
+	struct DiagramInvariants
+	{
+		size_t grid_number = 0;
+		size_t number_of_components = 0;
+		size_t number_of_crossings = 0;
+		int64_t writhe = 0;
+
+		// The sum of the linking numbers of all pairs of components (0 for knots)
+		int64_t linking_number = 0;
+
+		// |Δ(-1)|, where Δ is the Alexander polynomial (0 for split links), or -1 if it's too large to represent
+		int64_t determinant = 0;
+	};
+
+	namespace detail
+	{
+
+		/// Returns `base` to the power of `exponent`, modulo `modulus` (which must be less than 2^32).
+		inline uint64_t power_mod(uint64_t base, uint64_t exponent, uint64_t modulus)
+		{
+			uint64_t result = 1;
+			base %= modulus;
+			while (exponent > 0)
+			{
+				if (exponent & 1)
+				{
+					result = result * base % modulus;
+				}
+				base = base * base % modulus;
+				exponent >>= 1;
+			}
+
+			return result;
+		}
+
+		/// Returns the determinant of `matrix` (a square matrix of integers), modulo the prime `modulus` (which
+		/// must be less than 2^32, so that products of residues fit in 64 bits).
+		inline uint64_t get_determinant_mod(std::vector<std::vector<int64_t>> matrix, uint64_t modulus)
+		{
+			const auto size = matrix.size();
+
+			std::vector<std::vector<uint64_t>> residues(size, std::vector<uint64_t>(size));
+			for (size_t i = 0; i < size; ++i)
+			{
+				for (size_t j = 0; j < size; ++j)
+				{
+					const auto value = matrix[i][j] % static_cast<int64_t>(modulus);
+					residues[i][j] = static_cast<uint64_t>(value < 0 ? value + static_cast<int64_t>(modulus) : value);
+				}
+			}
+
+			// Gaussian elimination over the integers modulo `modulus`
+			uint64_t determinant = 1;
+			for (size_t k = 0; k < size; ++k)
+			{
+				size_t pivot = k;
+				while (pivot < size && residues[pivot][k] == 0)
+				{
+					pivot++;
+				}
+				if (pivot == size)
+				{
+					return 0;
+				}
+				if (pivot != k)
+				{
+					std::swap(residues[pivot], residues[k]);
+					determinant = (modulus - determinant) % modulus;
+				}
+
+				determinant = determinant * residues[k][k] % modulus;
+				const auto inverse = power_mod(residues[k][k], modulus - 2, modulus);
+
+				for (size_t i = k + 1; i < size; ++i)
+				{
+					const auto factor = residues[i][k] * inverse % modulus;
+					if (factor == 0)
+					{
+						continue;
+					}
+
+					for (size_t j = k; j < size; ++j)
+					{
+						residues[i][j] = (residues[i][j] + (modulus - factor) * residues[k][j]) % modulus;
+					}
+				}
+			}
+
+			return determinant;
+		}
+
+	}
+
+	/// Computes the invariants of `diagram` (see `DiagramInvariants`).
+	///
+	/// In each column, the `x` is connected to the `o`, and in each row, the `o` is connected to the `x`, with the
+	/// vertical segments crossing over the horizontal ones. The determinant comes from the "minesweeper" matrix of
+	/// the grid (Manolescu, Ozsváth, Sarkar): the matrix whose entries are t^-w(p), where w(p) is the winding number
+	/// of the diagram around each lattice point p, has determinant ±t^a (1 - t)^(n - 1) Δ(t). At t = -1, every
+	/// entry is ±1, so the determinant is computed exactly (modulo two primes, and then reconstructed) and divided
+	/// by 2^(n - 1).
+	inline DiagramInvariants get_invariants(const Diagram& diagram)
+	{
+		const auto size = diagram.get_size();
+
+		// The column of the `x` / `o` in each row, and the row of the `x` / `o` in each column
+		std::vector<size_t> x_col(size);
+		std::vector<size_t> o_col(size);
+		std::vector<size_t> x_row(size);
+		std::vector<size_t> o_row(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			std::tie(x_col[i], o_col[i]) = diagram.find_indices_of_xo(Axis::ROW, i);
+			x_row[x_col[i]] = i;
+			o_row[o_col[i]] = i;
+		}
+
+		DiagramInvariants invariants;
+		invariants.grid_number = size;
+
+		// Label the component that each column's vertical segment belongs to: from the `o` in a column, the curve
+		// moves (along a row) to the `x` in the same row, which starts the next vertical segment
+		std::vector<size_t> component(size, size);
+		for (size_t start = 0; start < size; ++start)
+		{
+			if (component[start] != size)
+			{
+				continue;
+			}
+
+			for (auto col = start; component[col] == size; col = x_col[o_row[col]])
+			{
+				component[col] = invariants.number_of_components;
+			}
+			invariants.number_of_components++;
+		}
+
+		// Every crossing is where the horizontal segment in row `i` (running from its `o` to its `x`) passes under
+		// the vertical segment in column `j` (running from its `x` to its `o`)
+		for (size_t i = 0; i < size; ++i)
+		{
+			const auto [left, right] = std::minmax(x_col[i], o_col[i]);
+			const int horizontal_direction = x_col[i] > o_col[i] ? 1 : -1;
+
+			for (auto j = left + 1; j < right; ++j)
+			{
+				const auto [top, bottom] = std::minmax(x_row[j], o_row[j]);
+				if (i <= top || i >= bottom)
+				{
+					continue;
+				}
+
+				// With the vertical strand on top, the sign of the crossing is the product of the directions of the
+				// two strands (+1 to the right, and +1 down the page)
+				const int vertical_direction = o_row[j] > x_row[j] ? 1 : -1;
+				const int sign = horizontal_direction * vertical_direction;
+
+				invariants.number_of_crossings++;
+				invariants.writhe += sign;
+				if (component[j] != component[x_col[i]])
+				{
+					invariants.linking_number += sign;
+				}
+			}
+		}
+		invariants.linking_number /= 2;
+
+		// The winding number around the lattice point at the top-left corner of each cell: a ray cast to the left
+		// of it crosses the vertical segments whose rows straddle the point
+		std::vector<std::vector<int64_t>> minesweeper(size, std::vector<int64_t>(size));
+		for (size_t i = 0; i < size; ++i)
+		{
+			int64_t winding_number = 0;
+			for (size_t j = 0; j < size; ++j)
+			{
+				if (j > 0)
+				{
+					const auto [top, bottom] = std::minmax(x_row[j - 1], o_row[j - 1]);
+					if (top < i && i <= bottom)
+					{
+						winding_number += o_row[j - 1] > x_row[j - 1] ? 1 : -1;
+					}
+				}
+
+				minesweeper[i][j] = std::abs(winding_number) % 2 == 0 ? 1 : -1;
+			}
+		}
+
+		// Reconstruct the determinant from its residues modulo two primes: this is exact as long as it's less than
+		// half of their product (about 2^61), which is guaranteed for diagrams with at most 60 crossings (the
+		// determinant is at most 2^c, from the Kauffman bracket). Larger diagrams are checked against a third prime.
+		const uint64_t p = 2147483647;
+		const uint64_t q = 2147483629;
+		const uint64_t r = 2147483587;
+		const auto get_determinant = [&](uint64_t modulus) {
+			const auto scale = detail::power_mod(detail::power_mod(2, size - 1, modulus), modulus - 2, modulus);
+			return detail::get_determinant_mod(minesweeper, modulus) * scale % modulus;
+		};
+		const auto a = get_determinant(p);
+		const auto b = get_determinant(q);
+		const auto k = (b + q - a % q) % q * detail::power_mod(p % q, q - 2, q) % q;
+		const auto combined = a + p * k;
+		const auto product = p * q;
+
+		invariants.determinant = combined > product / 2 ? static_cast<int64_t>(product - combined) : static_cast<int64_t>(combined);
+
+		if (invariants.number_of_crossings > 60)
+		{
+			const auto c = get_determinant(r);
+			const auto residue = static_cast<uint64_t>(invariants.determinant) % r;
+			if (c != residue && c != (r - residue) % r)
+			{
+				invariants.determinant = -1;
+			}
+		}
+
+		return invariants;
+	}
+
+}
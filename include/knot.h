@@ -1,12 +1,25 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <memory_resource>
 
 #include "polygonal_curve.h"
 
 namespace knot
 {
 
+	// How the simulation responds when one of a bead's adjacent segments comes too close to another segment
+	enum class CollisionResponse
+	{
+		// Move the bead back to where it was at the start of the time step and mark it as "stuck"
+		REVERT,
+
+		// Move the bead as far along its step as it can go without any of its adjacent segments coming too close
+		// to another segment (the bead is only marked as "stuck" if it can't move at all)
+		ADVANCE
+	};
+
 	struct SimulationParams
 	{
 		// The (average?) length of each line segment ("stick"), prior to relaxation
@@ -41,8 +54,169 @@ namespace knot
 
 		// Epsilon used for numerical stability
 		float epsilon = 0.001f;
+
+		// Beads that are further apart than this don't repel each other (the electrostatic force falls off
+		// as `r^-(2 + alpha)`, so distant beads contribute next to nothing)
+		float repulsion_cutoff = starting_length * 4.0f;
+
+		// Extra padding added to the interaction radii when building neighbor lists: the lists are only 
+		// rebuilt once some bead has moved more than half of this distance
+		float skin = starting_length * 1.0f;
+
+		// What to do when a bead's adjacent segments come within `d_close` of another segment
+		CollisionResponse collision_response = CollisionResponse::REVERT;
+
+		// The number of bisection steps used to find the largest safe fraction of a step (only used with `CollisionResponse::ADVANCE`)
+		size_t collision_iterations = 6;
+
+		// The number of time steps between each resampling of the rope, which keeps segment lengths close to `starting_length` (0 disables resampling)
+		size_t resample_interval = 0;
+	};
+
+	/// Returns `x^N`, computed with repeated squaring (i.e. `O(log N)` multiplications)
+	template<unsigned int N>
+	inline float integer_power(float x)
+	{
+		if constexpr (N == 0)
+		{
+			return 1.0f;
+		}
+		else if constexpr (N % 2 == 0)
+		{
+			const auto half = integer_power<N / 2>(x);
+			return half * half;
+		}
+		else
+		{
+			return x * integer_power<N - 1>(x);
+		}
+	}
+
+	/// A force law whose exponents are arbitrary floats: this is the reference implementation,
+	/// which simply calls `powf` for every pair of beads
+	struct GenericForceLaw
+	{
+		/// Returns the magnitude of the spring force between two beads that are `r` units apart
+		static float attraction(float r, float /* inv_r */, const SimulationParams& params)
+		{
+			return powf(r, 1.0f + params.beta);
+		}
+
+		/// Returns the magnitude of the electrostatic force between two beads that are `r` units apart
+		static float repulsion(float r, float /* inv_r */, const SimulationParams& params)
+		{
+			return powf(r, -(2.0f + params.alpha));
+		}
 	};
 
+	/// A force law whose exponents are known at compile-time, so that each force can be built
+	/// from a handful of multiplications (and the reciprocal distance that is already needed to 
+	/// normalize the direction vector) rather than a call to `powf`
+	template<unsigned int Beta, unsigned int Alpha>
+	struct IntegerForceLaw
+	{
+		static float attraction(float r, float /* inv_r */, const SimulationParams& /* params */)
+		{
+			return integer_power<1 + Beta>(r);
+		}
+
+		static float repulsion(float /* r */, float inv_r, const SimulationParams& /* params */)
+		{
+			return integer_power<2 + Alpha>(inv_r);
+		}
+	};
+
+	/// A symmetric neighbor list, stored as one contiguous array of indices (with an offset per element) rather
+	/// than as a vector per element, so that rebuilding it only allocates when the total number of pairs exceeds
+	/// every previous build
+	class NeighborList
+	{
+
+	public:
+
+		/// The indices of the neighbors of a single element
+		struct Range
+		{
+			const size_t* first;
+			const size_t* last;
+
+			const size_t* begin() const { return first; }
+			const size_t* end() const { return last; }
+		};
+
+		/// Starts a new build over `count` elements (keeping the storage of the previous one).
+		void clear(size_t count)
+		{
+			number_of_elements = count;
+			pairs.clear();
+		}
+
+		/// Records that elements `i` and `j` are neighbors of each other.
+		void add_pair(size_t i, size_t j)
+		{
+			pairs.emplace_back(i, j);
+		}
+
+		/// Sorts the recorded pairs into per-element ranges (with a counting sort, so the neighbors of each
+		/// element stay in the order that they were added).
+		void finish()
+		{
+			offsets.assign(number_of_elements + 1, 0);
+			for (const auto& [i, j] : pairs)
+			{
+				offsets[i + 1]++;
+				offsets[j + 1]++;
+			}
+			for (size_t i = 0; i < number_of_elements; ++i)
+			{
+				offsets[i + 1] += offsets[i];
+			}
+
+			// Use the start of each range as a cursor, then shift the cursors back afterwards
+			indices.resize(pairs.size() * 2);
+			for (const auto& [i, j] : pairs)
+			{
+				indices[offsets[i]++] = j;
+				indices[offsets[j]++] = i;
+			}
+			for (size_t i = number_of_elements; i > 0; --i)
+			{
+				offsets[i] = offsets[i - 1];
+			}
+			offsets[0] = 0;
+
+			// The number of pairs creeps up as the knot tightens, so once the storage is nearly full, make room for
+			// the next several builds at once (rather than growing a little on each one)
+			const auto make_room = [](auto& storage) {
+				if (storage.capacity() < storage.size() + storage.size() / 2)
+				{
+					storage.reserve(storage.size() * 2);
+				}
+			};
+			make_room(pairs);
+			make_room(indices);
+		}
+
+		Range operator[](size_t i) const
+		{
+			return { indices.data() + offsets[i], indices.data() + offsets[i + 1] };
+		}
+
+	private:
+
+		size_t number_of_elements = 0;
+
+		// The pairs recorded since the last call to `clear`
+		std::vector<std::pair<size_t, size_t>> pairs;
+
+		// The neighbors of element `i` are `indices[offsets[i]]` through `indices[offsets[i + 1] - 1]`
+		std::vector<size_t> offsets;
+		std::vector<size_t> indices;
+
+	};
+
+	class Checkpoint;
+
 	class Bead
 	{
 
@@ -111,6 +285,7 @@ namespace knot
 		bool is_stuck;
 
 		friend class Knot;
+		friend class Checkpoint;
 		friend bool operator==(const Bead& a, const Bead& b);
 	};
 
@@ -143,13 +318,8 @@ namespace knot
 		{
 			std::cout << "Constructing a new knot..." << std::endl;
 
-			// Initialize beads
-			for (size_t i = 0; i < rope.get_number_of_vertices(); ++i)
-			{
-				const auto [l, r] = rope.get_neighboring_indices_wrapped(i);
-
-				beads.push_back(Bead{ rope.get_vertices()[i], i, l, r });
-			}
+			select_force_law();
+			build_beads();
 		}
 
 		/// Returns a reference to the polyline that formed this knot, prior to relaxation.
@@ -168,135 +338,416 @@ namespace knot
 		/// physics.
 		void relax(bool use_anchors = true)
 		{
+			// The exponents may have been changed (i.e. via the UI) since the last time step
+			if (params.beta != force_law_beta || params.alpha != force_law_alpha)
+			{
+				select_force_law();
+			}
+
+			(this->*relax_function)(use_anchors);
+			number_of_steps++;
+
+			if (params.resample_interval > 0 && ++steps_since_resample >= params.resample_interval)
+			{
+				resample();
+			}
+		}
+
+		/// Adaptively resamples the rope (see `PolygonalCurve::refine`) so that its segments stay close to
+		/// `starting_length`, without letting any new segment come within `d_close` of another one. The number
+		/// of beads will (most likely) change, so all velocities are discarded and the resampled rope becomes
+		/// the new set of anchors.
+		void resample()
+		{
+			// Segments end up between 0.75x and 1.5x the starting length (or shorter in tight bends)
+			rope = rope.refine(params.starting_length * 0.75f, false, params.d_close);
+			anchors = rope;
+
+			build_beads();
+		}
+
+		/// Returns the number of time steps that have been simulated since this knot was created (or last reset).
+		size_t get_number_of_steps() const
+		{
+			return number_of_steps;
+		}
+
+		/// Resets the physics simulation.
+		void reset()
+		{
+			rope = anchors;
+			number_of_steps = 0;
+
+			build_beads();
+		}
+
+		/// Returns a vector containing one integer per bead: 1 if the bead is stuck, 0 if it isn't
+		std::vector<int32_t> get_stuck() const
+		{
+			std::vector<int32_t> stuck;
+			stuck.reserve(beads.size());
+			write_stuck(std::back_inserter(stuck));
+
+			return stuck;
+		}
+
+		/// Same as `get_stuck()`, but the vector is allocated from `resource` (for example, a per-frame `utils::Arena`)
+		std::pmr::vector<int32_t> get_stuck(std::pmr::memory_resource* resource) const
+		{
+			std::pmr::vector<int32_t> stuck{ resource };
+			stuck.reserve(beads.size());
+			write_stuck(std::back_inserter(stuck));
+
+			return stuck;
+		}
+
+		/// Writes one integer per bead (1 if the bead is stuck, 0 if it isn't) to `destination`, which can be
+		/// any output iterator (for example, a pointer into a mapped GPU buffer). Returns the iterator one past
+		/// the last value that was written.
+		template<typename OutputIterator>
+		OutputIterator write_stuck(OutputIterator destination) const
+		{
+			return std::transform(beads.begin(), beads.end(), destination, [](const Bead& bead) -> int32_t {
+				return bead.is_stuck ? 1 : 0;
+			});
+		}
+
+		/// Writes the position of each bead to `destination` (see `write_stuck`).
+		template<typename OutputIterator>
+		OutputIterator write_positions(OutputIterator destination) const
+		{
+			return std::transform(beads.begin(), beads.end(), destination, [](const Bead& bead) -> glm::vec3 {
+				return bead.position;
+			});
+		}
+
+	private:
+
+		using RelaxFunction = void (Knot::*)(bool);
+
+		/// Creates one (stationary) bead per vertex of the rope.
+		void build_beads()
+		{
+			beads.clear();
+
+			for (size_t i = 0; i < rope.get_number_of_vertices(); ++i)
+			{
+				const auto [l, r] = rope.get_neighboring_indices_wrapped(i);
+
+				beads.push_back(Bead{ rope.get_vertices()[i], i, l, r });
+			}
+
+			// Force the neighbor lists to be rebuilt on the next time step
+			neighbor_list_positions.clear();
+			steps_since_resample = 0;
+		}
+
+		struct ForceLawEntry
+		{
+			float beta;
+			float alpha;
+			RelaxFunction relax_function;
+		};
+
+		/// Picks the fastest force law that matches the current exponents: common integer
+		/// exponent pairs (including the defaults) get a specialized kernel, and everything 
+		/// else falls back to `GenericForceLaw`.
+		void select_force_law()
+		{
+			static const std::array<ForceLawEntry, 15> specialized =
+			{{
+				{ 1.0f, 1.0f, &Knot::relax_with<IntegerForceLaw<1, 1>> },
+				{ 1.0f, 2.0f, &Knot::relax_with<IntegerForceLaw<1, 2>> },
+				{ 1.0f, 3.0f, &Knot::relax_with<IntegerForceLaw<1, 3>> },
+				{ 1.0f, 4.0f, &Knot::relax_with<IntegerForceLaw<1, 4>> },
+				{ 1.0f, 5.0f, &Knot::relax_with<IntegerForceLaw<1, 5>> },
+				{ 2.0f, 1.0f, &Knot::relax_with<IntegerForceLaw<2, 1>> },
+				{ 2.0f, 2.0f, &Knot::relax_with<IntegerForceLaw<2, 2>> },
+				{ 2.0f, 3.0f, &Knot::relax_with<IntegerForceLaw<2, 3>> },
+				{ 2.0f, 4.0f, &Knot::relax_with<IntegerForceLaw<2, 4>> },
+				{ 2.0f, 5.0f, &Knot::relax_with<IntegerForceLaw<2, 5>> },
+				{ 3.0f, 1.0f, &Knot::relax_with<IntegerForceLaw<3, 1>> },
+				{ 3.0f, 2.0f, &Knot::relax_with<IntegerForceLaw<3, 2>> },
+				{ 3.0f, 3.0f, &Knot::relax_with<IntegerForceLaw<3, 3>> },
+				{ 3.0f, 4.0f, &Knot::relax_with<IntegerForceLaw<3, 4>> },
+				{ 3.0f, 5.0f, &Knot::relax_with<IntegerForceLaw<3, 5>> }
+			}};
+
+			relax_function = &Knot::relax_with<GenericForceLaw>;
+
+			for (const auto& entry : specialized)
+			{
+				if (entry.beta == params.beta && entry.alpha == params.alpha)
+				{
+					relax_function = entry.relax_function;
+					break;
+				}
+			}
+
+			force_law_beta = params.beta;
+			force_law_alpha = params.alpha;
+		}
+
+		/// Runs a single time step of the simulation, where the forces between beads are 
+		/// calculated using `ForceLaw`.
+		template<typename ForceLaw>
+		void relax_with(bool use_anchors)
+		{
+			if (neighbor_lists_need_rebuild())
+			{
+				build_neighbor_lists();
+			}
+
 			for (auto& bead : beads)
 			{
 				// Sum all of the forces acting on this particular bead
 				auto force = glm::vec3{};
 
-				// Iterate over all potential neighbors
-				for (auto& other : beads) 
+				// Calculate the (attractive) mechanical spring forces that will pull this bead towards its neighbors
+				for (const auto other_index : { bead.neighbor_l_index, bead.neighbor_r_index })
 				{
+					const auto direction = beads[other_index].position - bead.position;
+					const auto r_squared = glm::dot(direction, direction);
 
-					// Don't accumulate forces on itself
-					if (other != bead)
+					if (r_squared < params.epsilon * params.epsilon)
 					{
+						continue;
+					}
 
-						// Grab the "other" bead, which may or may not be a neighbor to "bead"
-						if (bead.are_neighbors(other))
-						{
-							// This is a neighboring bead: calculate the (attractive) mechanical spring force that will pull this bead towards `other`
-							auto direction = other.position - bead.position;
-							auto r = glm::length(direction);
-							direction = glm::normalize(direction);
+					const auto inv_r = glm::inversesqrt(r_squared);
+					const auto r = r_squared * inv_r;
 
-							if (abs(r) < params.epsilon)
-							{
-								continue;
-							}
+					force += direction * inv_r * params.h * ForceLaw::attraction(r, inv_r, params);
 
-							force += direction * params.h * powf(r, 1.0f + params.beta);
-						}
-						else
-						{
-							// This is NOT a neighboring bead: calculate the (repulsive) electrostatic force - notice the direction vector is reversed!
-							auto direction = bead.position - other.position; 
-							auto r = glm::length(direction);
-							direction = glm::normalize(direction);
+					// Don't count the same neighbor twice on (degenerate) curves with only two vertices
+					if (bead.neighbor_l_index == bead.neighbor_r_index)
+					{
+						break;
+					}
+				}
 
-							if (abs(r) < params.epsilon)
-							{
-								continue;
-							}
+				// Calculate the (repulsive) electrostatic forces from all nearby, non-neighboring beads - notice the direction vector is reversed!
+				for (const auto other_index : bead_neighbors[bead.index])
+				{
+					const auto direction = bead.position - beads[other_index].position;
+					const auto r_squared = glm::dot(direction, direction);
 
-							force += direction * params.k * powf(r, -(2.0f + params.alpha));
-						}
+					if (r_squared < params.epsilon * params.epsilon || r_squared > params.repulsion_cutoff * params.repulsion_cutoff)
+					{
+						continue;
 					}
+
+					const auto inv_r = glm::inversesqrt(r_squared);
+					const auto r = r_squared * inv_r;
+
+					force += direction * inv_r * params.k * ForceLaw::repulsion(r, inv_r, params);
 				}
 
 				// Apply anchor force
 				if (use_anchors)
 				{
-					auto direction = anchors.get_vertices()[bead.index] - bead.position;
-					auto r = glm::length(direction);
-					direction = glm::normalize(direction);
+					const auto direction = anchors.get_vertices()[bead.index] - bead.position;
+					const auto r_squared = glm::dot(direction, direction);
 
-					if (abs(r) > params.epsilon)
+					if (r_squared > params.epsilon * params.epsilon)
 					{
-						force += (direction * params.h * powf(r, 1.0f + params.beta)) * params.anchor_weight;
+						const auto inv_r = glm::inversesqrt(r_squared);
+						const auto r = r_squared * inv_r;
+
+						force += (direction * inv_r * params.h * ForceLaw::attraction(r, inv_r, params)) * params.anchor_weight;
 					}
 				}
 
 				bead.apply_forces(force, params);
 				bead.is_stuck = false;
 
-				// Check for any new segment-segment intersections: remember that segments are indexed by their "left"
-				// endpoint, so the segment at index `bead.index` is actually the segment to the "right" of the bead
-				const auto segment_l = rope.get_segment(bead.neighbor_l_index);
-				const auto segment_r = rope.get_segment(bead.index);
-				for (size_t segment_index = 0; segment_index < rope.get_number_of_vertices(); segment_index++)
+				if (params.collision_response == CollisionResponse::ADVANCE)
+				{
+					advance_bead(bead);
+				}
+				else
 				{
-					// For all non-adjacent segments...
-					if (segment_index != bead.neighbor_l_index && 
-						segment_index != bead.index &&
-						segment_index != rope.get_wrapped_index(bead.neighbor_l_index - 1) &&
-						segment_index != rope.get_wrapped_index(bead.neighbor_r_index))
+					// Check for any new segment-segment intersections: remember that segments are indexed by their "left"
+					// endpoint, so the segment at index `bead.index` is actually the segment to the "right" of the bead
+					const auto segment_at = [&](size_t segment_index) { return rope.get_segment(segment_index); };
+
+					if (is_too_close(segment_at(bead.neighbor_l_index), bead.neighbor_l_index, bead.neighbor_r_index, segment_at) ||
+						is_too_close(segment_at(bead.index), bead.index, rope.get_wrapped_index(bead.neighbor_l_index - 1), segment_at))
 					{
-						const auto other = rope.get_segment(segment_index);
-						auto closest_to_l = segment_l.shortest_distance_between(other);
-						auto closest_to_r = segment_r.shortest_distance_between(other);
+						bead.position = bead.prev_position;
+						bead.is_stuck = true;
+					}
+				}
+			}
 
-						if (glm::length(closest_to_l) < params.d_close || glm::length(closest_to_r) < params.d_close)
-						{
-							//std::cout << "Bead at index " << bead.index << " has adjacent segments that are too close to segment: " << segment_index << "\n";
-							//std::cout << "\tDistance to L segment: " << glm::length(closest_to_l) << "\n";
-							//std::cout << "\tDistance to R segment: " << glm::length(closest_to_r) << "\n";
+			// Update polyline positions for rendering
+			gather_position_data(positions);
+			rope.set_vertices(positions);
+		}
 
-							bead.position = bead.prev_position;
-							bead.is_stuck = true;
+		/// Returns `true` if `segment` (which sits at index `segment_index` along the curve) is within `d_close` of
+		/// any of its (non-adjacent) neighboring segments, other than the segment at `skip_index`. The neighboring
+		/// segments are looked up via `segment_at`.
+		///
+		/// Each segment's neighbor list already excludes the segment itself and the two segments that share an
+		/// endpoint with it, so callers only have to skip the segment on the far side of the bead.
+		template<typename SegmentAt>
+		bool is_too_close(const geom::Segment& segment, size_t segment_index, size_t skip_index, SegmentAt segment_at) const
+		{
+			// Gather the neighboring segments into a contiguous batch, so that they can be tested several at a time
+			nearby_segments.clear();
+			for (const auto other_index : segment_neighbors[segment_index])
+			{
+				if (other_index != skip_index)
+				{
+					nearby_segments.push_segment(segment_at(other_index));
+				}
+			}
 
-							break;
-						}
-					}
+			return nearby_segments.shortest_distance_to(segment, params.d_close).first_hit != geom::BatchedDistance::no_hit;
+		}
+
+		/// Returns `true` if either of the segments adjacent to `bead` is within `d_close` of another segment, using
+		/// the current (i.e. partially updated) bead positions rather than the rope from the previous time step.
+		bool is_bead_too_close(const Bead& bead) const
+		{
+			const auto segment_at = [&](size_t segment_index) 
+			{
+				return geom::Segment{ beads[segment_index].position, beads[beads[segment_index].neighbor_r_index].position };
+			};
+
+			return is_too_close(segment_at(bead.neighbor_l_index), bead.neighbor_l_index, bead.neighbor_r_index, segment_at) ||
+				is_too_close(segment_at(bead.index), bead.index, rope.get_wrapped_index(bead.neighbor_l_index - 1), segment_at);
+		}
+
+		/// Moves `bead` as far along its most recent step as it can go without either of its adjacent segments 
+		/// coming within `d_close` of another segment. The largest safe fraction of the step is found via bisection.
+		/// Since only this bead moves (by at most `d_max`, which is smaller than `d_close`) while the check is 
+		/// performed, no segment can pass through another one.
+		void advance_bead(Bead& bead)
+		{
+			if (!is_bead_too_close(bead))
+			{
+				return;
+			}
+
+			const auto start = bead.prev_position;
+			const auto step = bead.position - bead.prev_position;
+
+			auto safe = 0.0f;
+			auto unsafe = 1.0f;
+
+			for (size_t i = 0; i < params.collision_iterations; ++i)
+			{
+				const auto t = (safe + unsafe) * 0.5f;
+				bead.position = start + step * t;
+
+				if (is_bead_too_close(bead))
+				{
+					unsafe = t;
+				}
+				else
+				{
+					safe = t;
 				}
 			}
 
-			// Update polyline positions for rendering
-			rope.set_vertices(gather_position_data());
+			bead.position = start + step * safe;
+
+			// Don't keep pushing the bead into the obstacle on subsequent time steps
+			bead.velocity *= safe;
+			bead.is_stuck = safe == 0.0f;
 		}
 
-		/// Resets the physics simulation.
-		void reset()
+		/// Returns `true` if some bead may have moved far enough since the neighbor lists were
+		/// last built that a pair outside of the lists could now interact.
+		bool neighbor_lists_need_rebuild() const
 		{
-			rope = anchors;
+			if (neighbor_list_positions.size() != beads.size() ||
+				neighbor_list_radii != std::make_pair(params.repulsion_cutoff, params.d_close) ||
+				neighbor_list_skin != params.skin)
+			{
+				return true;
+			}
+
+			// Beads move (at most) `d_max` units during the upcoming step, so leave room for that as well
+			const auto threshold = std::max(params.skin * 0.5f - params.d_max, 0.0f);
 
 			for (size_t i = 0; i < beads.size(); ++i)
 			{
-				beads[i].position = anchors.get_vertices()[i];
-				beads[i].is_stuck = false;
+				const auto displacement = beads[i].position - neighbor_list_positions[i];
+
+				if (glm::dot(displacement, displacement) > threshold * threshold)
+				{
+					return true;
+				}
 			}
+
+			return false;
 		}
 
-		/// Returns a vector containing one integer per bead: 1 if the bead is stuck, 0 if it isn't
-		std::vector<int32_t> get_stuck() const
+		/// Rebuilds the (Verlet) neighbor lists used by the simulation: the bead-bead list records all pairs
+		/// of non-neighboring beads within `repulsion_cutoff + skin` of each other, and the segment-segment 
+		/// list records all pairs of non-adjacent segments that could be within `d_close + skin` of each other.
+		void build_neighbor_lists()
 		{
-			std::vector<int32_t> stuck;
-			std::transform(beads.begin(), beads.end(), std::back_inserter(stuck), [](Bead bead) -> int32_t {
-				return bead.is_stuck ? 1 : 0;
-			});
+			const auto number_of_beads = beads.size();
 
-			return stuck;
-		}
+			gather_position_data(neighbor_list_positions);
+			neighbor_list_radii = { params.repulsion_cutoff, params.d_close };
+			neighbor_list_skin = params.skin;
 
-	private:
+			bead_neighbors.clear(number_of_beads);
+			segment_neighbors.clear(number_of_beads);
 
-		std::vector<glm::vec3> gather_position_data() const
-		{
-			std::vector<glm::vec3> positions;
-			std::transform(beads.begin(), beads.end(), std::back_inserter(positions), [](Bead bead) -> glm::vec3 {
-				return bead.position; 
-			});
+			const auto bead_radius = params.repulsion_cutoff + params.skin;
+			const auto segment_radius = params.d_close + params.skin;
+
+			// Segments are indexed by their "left" endpoint, just like the rope
+			const auto segment = [&](size_t index) 
+			{ 
+				return geom::Segment{ neighbor_list_positions[index], neighbor_list_positions[(index + 1) % number_of_beads] };
+			};
+
+			for (size_t i = 0; i < number_of_beads; ++i)
+			{
+				const auto segment_i = segment(i);
+
+				for (size_t j = i + 1; j < number_of_beads; ++j)
+				{
+					// Bead-bead pairs
+					if (!beads[i].are_neighbors(beads[j]) &&
+						glm::distance(neighbor_list_positions[i], neighbor_list_positions[j]) < bead_radius)
+					{
+						bead_neighbors.add_pair(i, j);
+					}
+
+					// Segment-segment pairs: segments that share an endpoint are never tested against each other, 
+					// and the distance between the midpoints (minus the half-lengths) gives a conservative lower bound 
+					// on the distance between the segments themselves
+					if (j != beads[i].neighbor_l_index && j != beads[i].neighbor_r_index)
+					{
+						const auto segment_j = segment(j);
+						const auto lower_bound = glm::distance(segment_i.midpoint(), segment_j.midpoint()) - 
+							(segment_i.length() + segment_j.length()) * 0.5f;
+
+						if (lower_bound < segment_radius)
+						{
+							segment_neighbors.add_pair(i, j);
+						}
+					}
+				}
+			}
 
-			return positions;
+			bead_neighbors.finish();
+			segment_neighbors.finish();
+		}
+
+		/// Copies the position of each bead into `destination` (reusing its storage).
+		void gather_position_data(std::vector<glm::vec3>& destination) const
+		{
+			destination.resize(beads.size());
+			write_positions(destination.begin());
 		}
 
 		// The "rope" (polygonal line segment) that is knotted and will be animated
@@ -311,6 +762,42 @@ namespace knot
 		// The parameters that govern how the simulation behaves
 		SimulationParams params;
 
+		// The time step function (specialized on the force law) selected for the current exponents
+		RelaxFunction relax_function;
+
+		// The exponents that `relax_function` was selected for
+		float force_law_beta;
+		float force_law_alpha;
+
+		// For each bead, the indices of all non-neighboring beads that are close enough to (potentially) repel it
+		NeighborList bead_neighbors;
+
+		// For each segment, the indices of all non-adjacent segments that are close enough to (potentially) collide with it
+		NeighborList segment_neighbors;
+
+		// The bead positions at the time that the neighbor lists were last built
+		std::vector<glm::vec3> neighbor_list_positions;
+
+		// Scratch space for copying the bead positions back into the rope after each time step
+		std::vector<glm::vec3> positions;
+
+		// The repulsion cutoff and `d_close` that the neighbor lists were last built with
+		std::pair<float, float> neighbor_list_radii;
+
+		// The skin that the neighbor lists were last built with
+		float neighbor_list_skin;
+
+		// Scratch space for the segments that are tested in `is_too_close` (kept around to avoid reallocating every time step)
+		mutable geom::SegmentArray nearby_segments;
+
+		// The number of time steps since the rope was last resampled
+		size_t steps_since_resample = 0;
+
+		// The total number of time steps simulated so far
+		size_t number_of_steps = 0;
+
+		friend class Checkpoint;
+
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+#include "glm.hpp"
+
+#include "polygonal_curve.h"
+#include "tube.h"
+
+namespace geom
+{
+
+	/// The file formats that curves and tubes can be exported to
+	enum class MeshFormat
+	{
+		PLY, // Binary (little-endian) PLY
+		STL, // Binary STL (triangles only, so curves can't be exported to it)
+		OBJ  // Wavefront .obj (text)
+	};
+
+	/// An output iterator that hands every value that is written through it to `callback`, which lets the
+	/// tube generators (which write to output iterators) stream straight into a file
+	template<typename Callback>
+	class CallbackOutputIterator
+	{
+
+	public:
+
+		using iterator_category = std::output_iterator_tag;
+		using value_type = void;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = void;
+
+		CallbackOutputIterator(Callback& callback) :
+			callback{ &callback }
+		{}
+
+		template<typename T>
+		CallbackOutputIterator& operator=(const T& value)
+		{
+			(*callback)(value);
+			return *this;
+		}
+
+		CallbackOutputIterator& operator*()
+		{
+			return *this;
+		}
+
+		CallbackOutputIterator& operator++()
+		{
+			return *this;
+		}
+
+		CallbackOutputIterator& operator++(int)
+		{
+			return *this;
+		}
+
+	private:
+
+		Callback* callback;
+
+	};
+
+	/// Writers for exporting curves and tubes to common mesh formats, e.g. for rendering offline
+	///
+	/// Tubes are streamed: each ring (or triangle) is written to the file as soon as it is generated, so
+	/// memory use stays constant no matter how large the curve is. Binary formats are written in little-endian
+	/// byte order, which (like the checkpoints) assumes a little-endian machine.
+	class MeshExporter
+	{
+
+	public:
+
+		/// Writes the closed polyline `curve` to `stream`, as vertices plus edges (PLY) or a single polyline (OBJ).
+		static void write_curve(std::ostream& stream, const PolygonalCurve& curve, MeshFormat format)
+		{
+			check_curve_format(format);
+
+			const auto number_of_vertices = curve.get_number_of_vertices();
+
+			switch (format)
+			{
+			case MeshFormat::PLY:
+				stream << "ply\n"
+					<< "format binary_little_endian 1.0\n"
+					<< "element vertex " << number_of_vertices << "\n"
+					<< "property float x\n"
+					<< "property float y\n"
+					<< "property float z\n"
+					<< "element edge " << number_of_vertices << "\n"
+					<< "property int vertex1\n"
+					<< "property int vertex2\n"
+					<< "end_header\n";
+
+				for (const auto& vertex : curve.get_vertices())
+				{
+					write_vec3(stream, vertex);
+				}
+				for (size_t i = 0; i < number_of_vertices; ++i)
+				{
+					write_value(stream, static_cast<int32_t>(i));
+					write_value(stream, static_cast<int32_t>(curve.get_wrapped_index(i + 1)));
+				}
+				break;
+
+			case MeshFormat::OBJ:
+				for (const auto& vertex : curve.get_vertices())
+				{
+					stream << "v " << vertex.x << " " << vertex.y << " " << vertex.z << "\n";
+				}
+
+				// .obj indices are 1-based
+				stream << "l";
+				for (size_t i = 0; i < number_of_vertices; ++i)
+				{
+					stream << " " << i + 1;
+				}
+				stream << " 1\n";
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		/// Writes an extruded tube around `curve` (see `write_tube`) to `stream`. PLY and OBJ files get an indexed
+		/// mesh with per-vertex normals, while STL files get a triangle soup with per-face normals.
+		static void write_tube(std::ostream& stream, const PolygonalCurve& curve, MeshFormat format, float radius = 0.5f, size_t number_of_segments = 10)
+		{
+			const auto number_of_vertices = curve.get_number_of_vertices();
+			const auto number_of_ring_vertices = get_tube_ring_vertex_count(number_of_vertices, number_of_segments);
+			const auto number_of_triangles = get_tube_index_count(number_of_vertices, number_of_segments) / 3;
+
+			// Calls `write_vertex(position, normal)` for each ring vertex, in order
+			const auto visit_ring_vertices = [&](auto write_vertex) {
+				TubeBuilder{}.visit_rings(curve, [&](size_t, const TubeRing& ring) {
+					for (size_t segment = 0; segment < number_of_segments; ++segment)
+					{
+						const auto position = ring.vertex(segment, number_of_segments, radius);
+						write_vertex(position, (position - ring.center) / radius);
+					}
+				});
+			};
+
+			// Gathers indices into triangles, calling `write_triangle(indices)` for each one
+			const auto visit_triangles = [&](auto write_triangle) {
+				uint32_t indices[3];
+				size_t count = 0;
+
+				auto gather = [&](uint32_t index) {
+					indices[count++] = index;
+					if (count == 3)
+					{
+						write_triangle(indices);
+						count = 0;
+					}
+				};
+				write_tube_indices(number_of_vertices, CallbackOutputIterator<decltype(gather)>{ gather }, number_of_segments);
+			};
+
+			switch (format)
+			{
+			case MeshFormat::PLY:
+				stream << "ply\n"
+					<< "format binary_little_endian 1.0\n"
+					<< "element vertex " << number_of_ring_vertices << "\n"
+					<< "property float x\n"
+					<< "property float y\n"
+					<< "property float z\n"
+					<< "property float nx\n"
+					<< "property float ny\n"
+					<< "property float nz\n"
+					<< "element face " << number_of_triangles << "\n"
+					<< "property list uchar uint vertex_indices\n"
+					<< "end_header\n";
+
+				visit_ring_vertices([&](const glm::vec3& position, const glm::vec3& normal) {
+					write_vec3(stream, position);
+					write_vec3(stream, normal);
+				});
+				visit_triangles([&](const uint32_t* indices) {
+					write_value(stream, static_cast<uint8_t>(3));
+					stream.write(reinterpret_cast<const char*>(indices), sizeof(uint32_t) * 3);
+				});
+				break;
+
+			case MeshFormat::OBJ:
+				visit_ring_vertices([&](const glm::vec3& position, const glm::vec3& normal) {
+					stream << "v " << position.x << " " << position.y << " " << position.z << "\n";
+					stream << "vn " << normal.x << " " << normal.y << " " << normal.z << "\n";
+				});
+
+				// .obj indices are 1-based
+				visit_triangles([&](const uint32_t* indices) {
+					stream << "f";
+					for (size_t i = 0; i < 3; ++i)
+					{
+						stream << " " << indices[i] + 1 << "//" << indices[i] + 1;
+					}
+					stream << "\n";
+				});
+				break;
+
+			case MeshFormat::STL:
+			{
+				// An 80 byte header (which must not start with "solid", or readers will assume a text file)
+				char header[80] = {};
+				std::strncpy(header, "grid-diagrams tube", sizeof(header));
+				stream.write(header, sizeof(header));
+				write_value(stream, static_cast<uint32_t>(number_of_triangles));
+
+				glm::vec3 corners[3];
+				size_t count = 0;
+
+				auto gather = [&](const glm::vec3& corner) {
+					corners[count++] = corner;
+					if (count == 3)
+					{
+						const auto normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+						const auto length = glm::length(normal);
+
+						write_vec3(stream, length > 0.0f ? normal / length : glm::vec3{ 0.0f });
+						for (const auto& c : corners)
+						{
+							write_vec3(stream, c);
+						}
+						write_value(stream, static_cast<uint16_t>(0));
+						count = 0;
+					}
+				};
+				geom::write_tube(curve, CallbackOutputIterator<decltype(gather)>{ gather }, radius, number_of_segments);
+				break;
+			}
+			}
+		}
+
+		/// Exports `curve` to the file at `path` (see `write_curve`).
+		static void save_curve(const std::string& path, const PolygonalCurve& curve, MeshFormat format)
+		{
+			// Check this before creating the file, so that an unsupported format doesn't leave an empty file behind
+			check_curve_format(format);
+
+			auto file = open(path);
+			write_curve(file, curve, format);
+			close(file, path);
+		}
+
+		/// Exports a tube around `curve` to the file at `path` (see `write_tube`).
+		static void save_tube(const std::string& path, const PolygonalCurve& curve, MeshFormat format, float radius = 0.5f, size_t number_of_segments = 10)
+		{
+			auto file = open(path);
+			write_tube(file, curve, format, radius, number_of_segments);
+			close(file, path);
+		}
+
+	private:
+
+		static void check_curve_format(MeshFormat format)
+		{
+			if (format == MeshFormat::STL)
+			{
+				throw std::invalid_argument("Curves can't be exported as STL files (which only support triangles)");
+			}
+		}
+
+		static std::ofstream open(const std::string& path)
+		{
+			std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+			if (!file.is_open())
+			{
+				throw std::runtime_error("Unable to open file for writing: " + path);
+			}
+
+			return file;
+		}
+
+		static void close(std::ofstream& file, const std::string& path)
+		{
+			file.flush();
+			if (!file)
+			{
+				throw std::runtime_error("Failed to write file: " + path);
+			}
+		}
+
+		template<typename T>
+		static void write_value(std::ostream& stream, T value)
+		{
+			stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		static void write_vec3(std::ostream& stream, const glm::vec3& value)
+		{
+			write_value(stream, value.x);
+			write_value(stream, value.y);
+			write_value(stream, value.z);
+		}
+
+	};
+
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <vector>
+
+#include "glad/glad.h"
+#include "glm.hpp"
+
+#include "gpu_buffer.h"
+
+namespace graphics
+{
+
+    /// The layout of a single draw in a `glMultiDrawElementsIndirect` call (this is fixed by OpenGL)
+    struct DrawElementsIndirectCommand
+    {
+        uint32_t count;
+        uint32_t instance_count;
+        uint32_t first_index;
+        int32_t base_vertex;
+        uint32_t base_instance;
+    };
+
+    /// The part of a `MeshPool`'s shared buffers that holds one mesh, plus a bounding sphere (in the mesh's own
+    /// coordinate system) for culling it
+    struct PooledMesh
+    {
+        uint32_t first_index;
+        uint32_t index_count;
+        int32_t base_vertex;
+        uint32_t vertex_count;
+
+        glm::vec3 center;
+        float radius;
+    };
+
+    /// The six planes of a view frustum, extracted from a (projection * view) matrix, which bounding spheres can be
+    /// tested against
+    class Frustum
+    {
+    public:
+
+        Frustum(const glm::mat4& view_projection)
+        {
+            // Each plane is the sum or difference of the last row and one of the other rows (Gribb / Hartmann)
+            const auto get_row = [&](int row) {
+                return glm::vec4{ view_projection[0][row], view_projection[1][row], view_projection[2][row], view_projection[3][row] };
+            };
+
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                planes[axis * 2 + 0] = get_row(3) + get_row(axis);
+                planes[axis * 2 + 1] = get_row(3) - get_row(axis);
+            }
+
+            for (auto& plane : planes)
+            {
+                plane /= glm::length(glm::vec3{ plane });
+            }
+        }
+
+        /// Returns `false` if the sphere is entirely outside of (at least) one of the planes.
+        bool intersects_sphere(const glm::vec3& center, float radius) const
+        {
+            return std::all_of(planes.begin(), planes.end(), [&](const glm::vec4& plane) {
+                return glm::dot(glm::vec3{ plane }, center) + plane.w >= -radius;
+            });
+        }
+
+    private:
+
+        std::array<glm::vec4, 6> planes;
+    };
+
+    /// Many meshes packed back-to-back into a single vertex buffer and a single index buffer (behind one VAO), so
+    /// that any subset of them can be drawn with one `glMultiDrawElementsIndirect` call
+    ///
+    /// Each draw command's `base_instance` tells the shaders which mesh (and so, which per-mesh data, e.g. in a
+    /// shader storage buffer) it belongs to. GLSL 4.50 can't read the base instance directly, so the pool binds an
+    /// instanced attribute at `instance_attribute` that holds the sequence 0, 1, 2, ...: since instanced attributes
+    /// are offset by the base instance, each draw reads its own `base_instance` back out of it.
+    ///
+    /// Meshes are only ever added (or cleared all at once), which is rare, so the shared buffers are simply
+    /// re-uploaded in full the next time that the pool is drawn.
+    class MeshPool
+    {
+    public:
+
+        /// The attribute locations of the vertex position and the instance ID
+        static constexpr uint32_t position_attribute = 0;
+        static constexpr uint32_t instance_attribute = 3;
+
+        MeshPool() :
+            vertex_array{ create_vertex_array() },
+            buffer_position{ GL_STATIC_DRAW },
+            buffer_index{ GL_STATIC_DRAW },
+            buffer_instance{ GL_STATIC_DRAW },
+            buffer_indirect{ GL_STREAM_DRAW }
+        {
+            glVertexArrayElementBuffer(vertex_array, buffer_index.get_handle());
+
+            glVertexArrayVertexBuffer(vertex_array, 0, buffer_position.get_handle(), 0, sizeof(glm::vec3));
+            glEnableVertexArrayAttrib(vertex_array, position_attribute);
+            glVertexArrayAttribFormat(vertex_array, position_attribute, 3, GL_FLOAT, GL_FALSE, 0);
+            glVertexArrayAttribBinding(vertex_array, position_attribute, 0);
+
+            glVertexArrayVertexBuffer(vertex_array, 1, buffer_instance.get_handle(), 0, sizeof(uint32_t));
+            glVertexArrayBindingDivisor(vertex_array, 1, 1);
+            glEnableVertexArrayAttrib(vertex_array, instance_attribute);
+            glVertexArrayAttribIFormat(vertex_array, instance_attribute, 1, GL_UNSIGNED_INT, 0);
+            glVertexArrayAttribBinding(vertex_array, instance_attribute, 1);
+        }
+
+        MeshPool(const MeshPool& other) = delete;
+
+        MeshPool& operator=(const MeshPool& other) = delete;
+
+        ~MeshPool()
+        {
+            delete_vertex_array(vertex_array);
+        }
+
+        /// Appends a mesh to the pool and returns its index (which is also the `base_instance` of its draws).
+        size_t add(const std::vector<glm::vec3>& mesh_vertices, const std::vector<uint32_t>& mesh_indices)
+        {
+            auto lower = mesh_vertices.empty() ? glm::vec3{ 0.0f } : mesh_vertices[0];
+            auto upper = lower;
+            for (const auto& vertex : mesh_vertices)
+            {
+                lower = glm::min(lower, vertex);
+                upper = glm::max(upper, vertex);
+            }
+
+            meshes.push_back({
+                static_cast<uint32_t>(indices.size()),
+                static_cast<uint32_t>(mesh_indices.size()),
+                static_cast<int32_t>(vertices.size()),
+                static_cast<uint32_t>(mesh_vertices.size()),
+                (lower + upper) * 0.5f,
+                glm::length(upper - lower) * 0.5f
+            });
+
+            vertices.insert(vertices.end(), mesh_vertices.begin(), mesh_vertices.end());
+            indices.insert(indices.end(), mesh_indices.begin(), mesh_indices.end());
+            dirty = true;
+
+            return meshes.size() - 1;
+        }
+
+        /// Removes every mesh from the pool (the buffers keep their storage).
+        void clear()
+        {
+            meshes.clear();
+            vertices.clear();
+            indices.clear();
+            dirty = true;
+        }
+
+        const std::vector<PooledMesh>& get_meshes() const
+        {
+            return meshes;
+        }
+
+        size_t get_number_of_meshes() const
+        {
+            return meshes.size();
+        }
+
+        /// Returns a command that draws the whole mesh at `index` (once).
+        DrawElementsIndirectCommand get_draw_command(size_t index) const
+        {
+            const auto& mesh = meshes[index];
+            return { mesh.index_count, 1, mesh.first_index, mesh.base_vertex, static_cast<uint32_t>(index) };
+        }
+
+        /// Issues all of `commands` with a single draw call (the VAO stays bound afterwards).
+        template<typename Allocator>
+        void draw(const std::vector<DrawElementsIndirectCommand, Allocator>& commands)
+        {
+            if (commands.empty())
+            {
+                return;
+            }
+
+            if (dirty)
+            {
+                upload();
+            }
+
+            buffer_indirect.upload(commands);
+
+            glBindVertexArray(vertex_array);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer_indirect.get_handle());
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(commands.size()), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+
+    private:
+
+        uint32_t vertex_array;
+        GrowableBuffer buffer_position;
+        GrowableBuffer buffer_index;
+        GrowableBuffer buffer_instance;
+        GrowableBuffer buffer_indirect;
+
+        // Client-side copies of the shared buffers, which are appended to
+        std::vector<PooledMesh> meshes;
+        std::vector<glm::vec3> vertices;
+        std::vector<uint32_t> indices;
+        bool dirty = false;
+
+        void upload()
+        {
+            std::vector<uint32_t> instances(meshes.size());
+            std::iota(instances.begin(), instances.end(), 0);
+
+            buffer_position.upload(vertices);
+            buffer_index.upload(indices);
+            buffer_instance.upload(instances);
+            dirty = false;
+        }
+    };
+
+}
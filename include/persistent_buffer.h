@@ -0,0 +1,169 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+
+#include "glad/glad.h"
+
+#include "gpu_buffer.h"
+
+namespace graphics
+{
+
+    /// A GPU buffer whose storage is persistently (and coherently) mapped into client memory, so
+    /// that the CPU can write into it directly every frame without any intermediate copies
+    ///
+    /// The buffer is split into `number_of_regions` equally sized regions that are cycled through
+    /// (i.e. triple buffering, by default): while the CPU writes into one region, the GPU can still
+    /// be reading from the others, and a fence per region guards against overwriting data that is
+    /// still in use
+    ///
+    /// Since persistently mapped storage is immutable, growing the buffer (see `reserve`) means replacing it with
+    /// a new buffer object, so the capacity is doubled each time to keep that rare
+    class PersistentBuffer
+    {
+    public:
+
+        PersistentBuffer(size_t region_size, size_t number_of_regions = 3) :
+            region_size{ region_size },
+            number_of_regions{ number_of_regions },
+            fences(number_of_regions, nullptr)
+        {
+            allocate();
+        }
+
+        PersistentBuffer(const PersistentBuffer& other) = delete;
+
+        PersistentBuffer& operator=(const PersistentBuffer& other) = delete;
+
+        ~PersistentBuffer()
+        {
+            for (auto& fence : fences)
+            {
+                if (fence != nullptr)
+                {
+                    glDeleteSync(fence);
+                }
+            }
+
+            release();
+        }
+
+        uint32_t get_handle() const
+        {
+            return buffer_id;
+        }
+
+        /// Returns the size (in bytes) of each region.
+        size_t get_region_size() const
+        {
+            return region_size;
+        }
+
+        /// Makes sure that each region can hold at least `required_region_size` bytes. If it can't, the buffer is 
+        /// replaced with a larger one (once the GPU is done with all of the regions), so the handle changes and any
+        /// bindings have to be updated. Returns `true` if that happened.
+        bool reserve(size_t required_region_size)
+        {
+            if (required_region_size <= region_size)
+            {
+                return false;
+            }
+
+            for (size_t region = 0; region < number_of_regions; ++region)
+            {
+                wait(region);
+            }
+
+            release();
+
+            region_size = grow_capacity(region_size, required_region_size);
+            current_region = 0;
+            get_resource_counters().reallocations++;
+
+            allocate();
+
+            return true;
+        }
+
+        /// Returns the byte offset of the current region (i.e. the one that the most recent call to
+        /// `acquire` returned), which is where vertex buffer bindings should point.
+        size_t get_offset() const
+        {
+            return current_region * region_size;
+        }
+
+        /// Advances to the next region and returns a pointer to it, first waiting (if necessary) until
+        /// the GPU has finished reading from that region.
+        template<typename T>
+        T* acquire()
+        {
+            current_region = (current_region + 1) % number_of_regions;
+            wait(current_region);
+
+            return reinterpret_cast<T*>(mapped + get_offset());
+        }
+
+        /// Marks the end of all GPU commands that read from the current region: this should be called
+        /// (at least) once per frame, after the last draw call that sources from this buffer.
+        void fence()
+        {
+            auto& fence = fences[current_region];
+            if (fence != nullptr)
+            {
+                glDeleteSync(fence);
+            }
+
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+    private:
+
+        void allocate()
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+            buffer_id = create_buffer();
+            glNamedBufferStorage(buffer_id, region_size * number_of_regions, nullptr, flags);
+            mapped = static_cast<uint8_t*>(glMapNamedBufferRange(buffer_id, 0, region_size * number_of_regions, flags));
+
+            if (mapped == nullptr)
+            {
+                std::cerr << "Error: unable to persistently map buffer\n";
+            }
+        }
+
+        void release()
+        {
+            glUnmapNamedBuffer(buffer_id);
+            delete_buffer(buffer_id);
+        }
+
+        /// Blocks until the GPU has finished reading from `region` (if it was reading from it at all).
+        void wait(size_t region)
+        {
+            auto& fence = fences[region];
+            if (fence != nullptr)
+            {
+                // Wait in 1 second increments (flushing the command queue the first time around)
+                const uint64_t timeout = 1000000000;
+                auto status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+                while (status == GL_TIMEOUT_EXPIRED)
+                {
+                    status = glClientWaitSync(fence, 0, timeout);
+                }
+
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+
+        uint32_t buffer_id;
+        uint8_t* mapped;
+        size_t region_size;
+        size_t number_of_regions;
+        size_t current_region = 0;
+        std::vector<GLsync> fences;
+    };
+
+}
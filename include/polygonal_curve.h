@@ -2,7 +2,11 @@
 
 #define _USE_MATH_DEFINES
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <iterator>
+#include <limits>
 #include <math.h>
 #include <vector>
 
@@ -137,6 +141,78 @@ namespace geom
 			return vector_between_closest_points;
 		}
 
+		/// Returns `true` if this line segment passes through (or touches) the triangle with
+		/// vertices `p0`, `p1`, and `p2`.
+		///
+		/// Reference: https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
+		bool intersects_triangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) const
+		{
+			const auto direction = b - a;
+			const auto edge_1 = p1 - p0;
+			const auto edge_2 = p2 - p0;
+			const auto p = glm::cross(direction, edge_2);
+			const auto determinant = glm::dot(edge_1, p);
+
+			if (abs(determinant) < 1e-6f)
+			{
+				// The segment is parallel to the plane of the triangle: if it doesn't lie in 
+				// that plane, it can't intersect the triangle
+				const auto normal = glm::cross(edge_1, edge_2);
+				if (abs(glm::dot(a - p0, normal)) > 1e-6f * glm::length(normal))
+				{
+					return false;
+				}
+
+				// Otherwise, the segment either crosses one of the triangle's edges or lies
+				// completely inside of the triangle
+				for (const auto& edge : { Segment{ p0, p1 }, Segment{ p1, p2 }, Segment{ p2, p0 } })
+				{
+					if (glm::length(shortest_distance_between(edge)) < 1e-4f)
+					{
+						return true;
+					}
+				}
+
+				// A degenerate triangle (e.g. three vertices along a straight run) has no inside
+				if (glm::dot(normal, normal) < 1e-12f)
+				{
+					return false;
+				}
+
+				const auto inside = [&](const glm::vec3& point)
+				{
+					const auto c0 = glm::dot(glm::cross(p1 - p0, point - p0), normal);
+					const auto c1 = glm::dot(glm::cross(p2 - p1, point - p1), normal);
+					const auto c2 = glm::dot(glm::cross(p0 - p2, point - p2), normal);
+
+					return (c0 >= 0.0f && c1 >= 0.0f && c2 >= 0.0f) || (c0 <= 0.0f && c1 <= 0.0f && c2 <= 0.0f);
+				};
+
+				return inside(a);
+			}
+
+			const auto inv_determinant = 1.0f / determinant;
+			const auto s = a - p0;
+			const auto u = glm::dot(s, p) * inv_determinant;
+
+			if (u < 0.0f || u > 1.0f)
+			{
+				return false;
+			}
+
+			const auto q = glm::cross(s, edge_1);
+			const auto v = glm::dot(direction, q) * inv_determinant;
+
+			if (v < 0.0f || u + v > 1.0f)
+			{
+				return false;
+			}
+
+			const auto t = glm::dot(edge_2, q) * inv_determinant;
+
+			return t >= 0.0f && t <= 1.0f;
+		}
+
 	private:
 
 		glm::vec3 a;
@@ -144,6 +220,187 @@ namespace geom
 
 	};
 
+	/// The result of testing a single segment against a batch of segments (see `SegmentArray::shortest_distance_to`)
+	struct BatchedDistance
+	{
+		// Returned in place of an index when none of the segments were within the threshold
+		static constexpr size_t no_hit = static_cast<size_t>(-1);
+
+		// The smallest distance between the query segment and any of the segments that were tested
+		float minimum_distance;
+
+		// The index of the first segment that was closer than the threshold (or `no_hit`)
+		size_t first_hit;
+	};
+
+	/// A batch of line segments stored as a "structure of arrays" (one contiguous array per coordinate),
+	/// so that the distance from one segment to many others can be computed several segments at a time 
+	/// with SIMD instructions
+	class SegmentArray
+	{
+
+	public:
+
+		/// The number of segments that are processed together (i.e. the number of SIMD lanes): the
+		/// distance calculations for each group are branchless, which lets the compiler vectorize them
+		static constexpr size_t lane_width = 8;
+
+		/// Removes all of the segments from this batch (without releasing any memory).
+		void clear()
+		{
+			for (auto* coordinates : { &start_x, &start_y, &start_z, &end_x, &end_y, &end_z })
+			{
+				coordinates->clear();
+			}
+		}
+
+		/// Adds the segment `segment` to the end of this batch.
+		void push_segment(const Segment& segment)
+		{
+			start_x.push_back(segment.get_start().x);
+			start_y.push_back(segment.get_start().y);
+			start_z.push_back(segment.get_start().z);
+			end_x.push_back(segment.get_end().x);
+			end_y.push_back(segment.get_end().y);
+			end_z.push_back(segment.get_end().z);
+		}
+
+		/// Returns the number of segments in this batch.
+		size_t size() const
+		{
+			return start_x.size();
+		}
+
+		/// Computes the shortest distance between `segment` and each segment in this batch, stopping
+		/// as soon as a segment closer than `threshold` (which should be non-negative) is found: in that case, `first_hit` is the index
+		/// of the first such segment and `minimum_distance` only accounts for the segments that were
+		/// tested up to that point. 
+		///
+		/// This gives the same distances as `Segment::shortest_distance_between` (which remains the 
+		/// reference implementation) up to floating-point error, except for nearly degenerate or 
+		/// parallel segments, where the two differ in which of the (equally close) points they pick.
+		BatchedDistance shortest_distance_to(const Segment& segment, float threshold) const
+		{
+			const auto threshold_squared = threshold * threshold;
+			auto minimum_squared = std::numeric_limits<float>::max();
+
+			float distances_squared[lane_width];
+
+			// Returns the index of the first lane (out of the first `count`) that is closer than the threshold, 
+			// folding every lane up to and including that one into `minimum_squared`
+			const auto find_hit = [&](size_t count)
+			{
+				for (size_t lane = 0; lane < count; ++lane)
+				{
+					minimum_squared = std::min(minimum_squared, distances_squared[lane]);
+
+					if (distances_squared[lane] < threshold_squared)
+					{
+						return lane;
+					}
+				}
+
+				return count;
+			};
+
+			size_t offset = 0;
+			for (; offset + lane_width <= size(); offset += lane_width)
+			{
+				for (size_t lane = 0; lane < lane_width; ++lane)
+				{
+					distances_squared[lane] = distance_squared_at(segment, offset + lane);
+				}
+
+				float chunk_minimum = distances_squared[0];
+				for (size_t lane = 1; lane < lane_width; ++lane)
+				{
+					chunk_minimum = std::min(chunk_minimum, distances_squared[lane]);
+				}
+
+				// Only look at the individual lanes if at least one of them is a hit
+				if (chunk_minimum < threshold_squared)
+				{
+					const auto lane = find_hit(lane_width);
+					return { sqrtf(minimum_squared), offset + lane };
+				}
+
+				minimum_squared = std::min(minimum_squared, chunk_minimum);
+			}
+
+			// Handle any leftover segments
+			const auto remaining = size() - offset;
+			for (size_t lane = 0; lane < remaining; ++lane)
+			{
+				distances_squared[lane] = distance_squared_at(segment, offset + lane);
+			}
+
+			const auto lane = find_hit(remaining);
+			return { sqrtf(minimum_squared), lane < remaining ? offset + lane : BatchedDistance::no_hit };
+		}
+
+	private:
+
+		/// Returns the squared distance between `segment` and the segment at `index`, without branching.
+		///
+		/// Reference: Ericson, "Real-Time Collision Detection," section 5.1.9
+		float distance_squared_at(const Segment& segment, size_t index) const
+		{
+			const float epsilon = 1e-8f;
+
+			const auto& p1 = segment.get_start();
+			const auto d1 = segment.get_end() - p1;
+
+			// Direction of the other segment, and the vector between the two start points
+			const float d2x = end_x[index] - start_x[index];
+			const float d2y = end_y[index] - start_y[index];
+			const float d2z = end_z[index] - start_z[index];
+			const float rx = p1.x - start_x[index];
+			const float ry = p1.y - start_y[index];
+			const float rz = p1.z - start_z[index];
+
+			const float a = glm::dot(d1, d1);
+			const float b = d1.x * d2x + d1.y * d2y + d1.z * d2z;
+			const float c = d1.x * rx + d1.y * ry + d1.z * rz;
+			const float e = d2x * d2x + d2y * d2y + d2z * d2z;
+			const float f = d2x * rx + d2y * ry + d2z * rz;
+			const float denominator = a * e - b * b;
+
+			// Every candidate below is computed unconditionally (with safe denominators) and then selected
+			// between, so that the compiler can turn this into straight-line SIMD code
+			const auto clamp_01 = [](float x) { return std::min(std::max(x, 0.0f), 1.0f); };
+			const float safe_a = std::max(a, epsilon);
+			const float safe_e = std::max(e, epsilon);
+			const float safe_denominator = std::max(denominator, epsilon);
+
+			// Closest point on the first (infinite) line, clamped to the segment (pick the start point if the
+			// segments are parallel)
+			const float s_line = clamp_01((b * f - c * e) / safe_denominator);
+			const float s_initial = denominator > epsilon ? s_line : 0.0f;
+
+			// Closest point on the second segment to the point above: if that has to be clamped, recompute
+			// the closest point on the first segment
+			const float t_numerator = b * s_initial + f;
+			const float t = clamp_01(t_numerator / safe_e);
+			const float s_at_start = clamp_01(-c / safe_a);
+			const float s_at_end = clamp_01((b - c) / safe_a);
+			const float s = t_numerator < 0.0f ? s_at_start : (t_numerator > e ? s_at_end : s_initial);
+
+			const float dx = rx + d1.x * s - d2x * t;
+			const float dy = ry + d1.y * s - d2y * t;
+			const float dz = rz + d1.z * s - d2z * t;
+
+			return dx * dx + dy * dy + dz * dz;
+		}
+
+		std::vector<float> start_x;
+		std::vector<float> start_y;
+		std::vector<float> start_z;
+		std::vector<float> end_x;
+		std::vector<float> end_y;
+		std::vector<float> end_z;
+
+	};
+
 	class BoundingBox
 	{
 
@@ -255,20 +512,50 @@ namespace geom
 			return { neighbor_l_index, neighbor_r_index };
 		}
 
+		/// Returns the angle (in radians) that the curve turns through at the vertex at 
+		/// `index`, i.e. the angle between its incoming and outgoing segments (wrapping 
+		/// around as necessary).
+		float get_turning_angle(size_t index) const
+		{
+			const auto [neighbor_l_index, neighbor_r_index] = get_neighboring_indices_wrapped(index);
+
+			return turning_angle(vertices[neighbor_l_index], vertices[get_wrapped_index(index)], vertices[neighbor_r_index]);
+		}
+
 		/// Returns the total length of this curve (i.e. the sum of the lengths
-		/// of all of its segments).
+		/// of all of its segments, including the one that closes the loop).
 		float perimeter() const
 		{
-			float length = 0.0f;
+			if (vertices.empty())
+			{
+				return 0.0f;
+			}
 
-			for (size_t i = 0; i < get_number_of_vertices() + 1; ++i)
+			return get_cumulative_lengths().back();
+		}
+
+		/// Returns a table of cumulative arc lengths, where entry `i` is the length of the
+		/// curve from the first vertex to vertex `i` and the last entry (at index `n`) is the
+		/// perimeter of the (closed) curve. The table is cached until the vertices change.
+		///
+		/// Note that, since the cache is built lazily, concurrent calls on the same curve
+		/// from multiple threads are not safe.
+		const std::vector<float>& get_cumulative_lengths() const
+		{
+			if (!cumulative_lengths_valid)
 			{
-				const auto& a = vertices[get_wrapped_index(i + 0)];
-				const auto& b = vertices[get_wrapped_index(i + 1)];
-				length += glm::distance(a, b);
+				cumulative_lengths.resize(get_number_of_vertices() + 1);
+				cumulative_lengths[0] = 0.0f;
+
+				for (size_t i = 0; i < get_number_of_vertices(); ++i)
+				{
+					cumulative_lengths[i + 1] = cumulative_lengths[i] + get_segment(i).length();
+				}
+
+				cumulative_lengths_valid = true;
 			}
 
-			return length;
+			return cumulative_lengths;
 		}
 
 		/// Returns the bounding box of this curve.
@@ -283,174 +570,416 @@ namespace geom
 			return { vertices[get_wrapped_index(index + 0)], vertices[get_wrapped_index(index + 1)] };
 		}
 
-		/// Returns the point at `t` along this curve, where a value of `0.0`
-		/// corresponds to the first vertex and a value of `1.0` corresponds
-		/// to the last vertex.
+		/// Returns the point at `t` along this (closed) curve, where `t` is the fraction
+		/// of the perimeter traveled, starting from the first vertex: both `0.0` and `1.0`
+		/// correspond to the first vertex. The segment is found via binary search over the
+		/// cached arc length table, so each call is `O(log n)`.
 		glm::vec3 point_at(float t) const
 		{
+			if (vertices.empty())
+			{
+				return glm::vec3{};
+			}
+
 			// Clamp to range 0..1
 			t = fmin(t, 1.0f);
 			t = fmax(t, 0.0f);
 
-			// Short-cut: is this the first or last vertex of the curve?
-			if (t == 0.0f)
-			{
-				return vertices[0];
-			}
-			else if (t == 1.0f)
+			const auto& lengths = get_cumulative_lengths();
+			const auto desired_length = lengths.back() * t;
+
+			// Find the first segment that ends at (or past) the desired length
+			const auto found = std::lower_bound(lengths.begin() + 1, lengths.end(), desired_length);
+			const auto segment_index = std::min(static_cast<size_t>(std::distance(lengths.begin(), found)) - 1, get_number_of_vertices() - 1);
+
+			return point_along_segment(segment_index, desired_length);
+		}
+
+		/// Returns `number_of_samples` points that are spaced evenly (by arc length) around
+		/// this (closed) curve, starting at the first vertex. The segments and the samples are
+		/// traversed together, so this takes `O(n + m)` time rather than `O(m log n)`.
+		std::vector<glm::vec3> sample_uniform(size_t number_of_samples) const
+		{
+			std::vector<glm::vec3> samples;
+
+			if (vertices.empty())
 			{
-				return vertices.back();
+				return samples;
 			}
 
-			const auto desired_length = perimeter() * t;
-			auto traversed = 0.0f;
-			auto point = glm::vec3{};
+			samples.reserve(number_of_samples);
+
+			const auto& lengths = get_cumulative_lengths();
+			size_t segment_index = 0;
 
-			for (size_t i = 0; i < get_number_of_vertices(); ++i)
+			for (size_t i = 0; i < number_of_samples; ++i)
 			{
-				const auto segment = get_segment(i);
-				traversed += segment.length();
+				const auto desired_length = lengths.back() * (i / static_cast<float>(number_of_samples));
 
-				if (traversed >= desired_length)
+				while (segment_index < get_number_of_vertices() - 1 && lengths[segment_index + 1] < desired_length)
 				{
-					// We know that the point lies on this segment somewhere...
-					float along_segment = traversed - desired_length;
-					point = segment.point_at((segment.length() - along_segment) / segment.length());
-
-					break;
+					segment_index++;
 				}
+
+				samples.push_back(point_along_segment(segment_index, desired_length));
 			}
 
-			return point;
+			return samples;
 		}
 
-		PolygonalCurve refine(float minimum_segment_length, bool keep_existing_points = true) const
+		/// Returns an adaptively resampled copy of this curve:
+		///
+		/// 1. If `keep_existing_points` is `false`, vertices that sit on (nearly) straight runs or
+		///    that border segments shorter than `minimum_segment_length` are removed, as long as
+		///    the resulting segment is no longer than `2 * minimum_segment_length`
+		/// 2. Segments that are too long are split into evenly spaced pieces, where the maximum
+		///    length of each piece shrinks as the turning angle at either endpoint grows (so that
+		///    vertices are concentrated in tight bends)
+		///
+		/// Splitting a segment doesn't change the shape of the curve, and a vertex is only removed
+		/// if no other segment passes through the triangle swept out by "cutting the corner" (and,
+		/// if `clearance` is non-zero, the new segment stays at least `clearance` units away from
+		/// all other segments), so resampling never introduces a crossing. Segments are never split
+		/// into pieces shorter than `clearance` either, since the segments on either side of such a
+		/// piece would be closer than `clearance` to each other without sharing an endpoint.
+		///
+		/// Only the segments near each vertex are checked before removing it (see `SegmentGrid`), so
+		/// this takes roughly linear time.
+		PolygonalCurve refine(float minimum_segment_length, bool keep_existing_points = true, float clearance = 0.0f) const
 		{
+			const auto maximum_segment_length = minimum_segment_length * 2.0f;
+
+			// Vertices whose turning angle is smaller than this are considered to be part of a straight run
+			const auto straight_angle = static_cast<float>(M_PI) / 12.0f;
+
+			// Never reduce the curve to something smaller than a quadrilateral
+			const size_t minimum_number_of_vertices = 4;
+
+			auto points = vertices;
+
+			// Pass #1: remove redundant vertices, which are unlinked from their neighbors (rather than erased)
+			// while the pass is running, so that each removal only takes constant time
+			if (!keep_existing_points && points.size() > minimum_number_of_vertices)
+			{
+				const auto n = points.size();
+
+				auto links = Links{ std::vector<size_t>(n), std::vector<size_t>(n), std::vector<bool>(n, false) };
+				for (size_t i = 0; i < n; ++i)
+				{
+					links.l[i] = (i + n - 1) % n;
+					links.r[i] = (i + 1) % n;
+				}
+
+				// Segments are indexed by their "left" endpoint
+				auto grid = SegmentGrid{ points, maximum_segment_length + clearance };
+				for (size_t i = 0; i < n; ++i)
+				{
+					grid.insert(i, points[i], points[links.r[i]]);
+				}
+
+				size_t number_remaining = n;
+				for (size_t i = 0; i < n && number_remaining > minimum_number_of_vertices; ++i)
+				{
+					const auto& prev = points[links.l[i]];
+					const auto& curr = points[i];
+					const auto& next = points[links.r[i]];
+
+					const bool is_short = glm::distance(prev, curr) < minimum_segment_length || glm::distance(curr, next) < minimum_segment_length;
+					const bool is_straight = turning_angle(prev, curr, next) < straight_angle;
+
+					if ((is_short || is_straight) &&
+						glm::distance(prev, next) <= maximum_segment_length &&
+						can_remove_vertex(points, links, grid, i, clearance))
+					{
+						// The segment to the left of the vertex now runs all the way to `next`
+						links.r[links.l[i]] = links.r[i];
+						links.l[links.r[i]] = links.l[i];
+						links.is_removed[i] = true;
+						number_remaining--;
+
+						grid.insert(links.l[i], prev, next);
+					}
+				}
+
+				std::vector<glm::vec3> remaining;
+				remaining.reserve(number_remaining);
+				for (size_t i = 0; i < n; ++i)
+				{
+					if (!links.is_removed[i])
+					{
+						remaining.push_back(points[i]);
+					}
+				}
+				points = std::move(remaining);
+			}
+
+			// Pass #2: split long segments, using shorter pieces in regions of high curvature
 			auto refined = PolygonalCurve{};
 
-			// TODO: previous ways of doing this didn't work - needs more R+D...
+			const auto n = points.size();
+			for (size_t i = 0; i < n; ++i)
+			{
+				const auto& a = points[i];
+				const auto& b = points[(i + 1) % n];
 
-			throw std::runtime_error("Unimplemented");
+				const auto curvature = std::max(
+					turning_angle(points[(i + n - 1) % n], a, b),
+					turning_angle(a, b, points[(i + 2) % n])
+				);
+
+				// A right angle (i.e. the corners of a grid diagram) halves the maximum segment length
+				const auto local_maximum = maximum_segment_length / (1.0f + curvature / static_cast<float>(M_PI_2));
+				auto pieces = std::max(static_cast<size_t>(ceilf(glm::distance(a, b) / local_maximum)), size_t{ 1 });
+
+				// ...but never into pieces that are shorter than `clearance`
+				if (clearance > 0.0f)
+				{
+					pieces = std::min(pieces, std::max(static_cast<size_t>(glm::distance(a, b) / clearance), size_t{ 1 }));
+				}
+
+				refined.push_vertex(a);
+				for (size_t piece = 1; piece < pieces; ++piece)
+				{
+					refined.push_vertex(glm::lerp(a, b, piece / static_cast<float>(pieces)));
+				}
+			}
+
+			return refined;
 		}
 
 		/// Deletes all of the vertices that make up this curve.
 		void clear()
 		{
 			vertices.clear();
+			cumulative_lengths_valid = false;
 		}
 
 		/// Adds a new vertex `vertex` to the end of the curve.
 		void push_vertex(const glm::vec3& vertex)
 		{
 			vertices.push_back(vertex);
+			cumulative_lengths_valid = false;
 		}
 
 		/// Removes the last vertex from the curve.
 		void pop_vertex()
 		{
 			vertices.pop_back();
+			cumulative_lengths_valid = false;
 		}
 
 		/// Effectively "clears" this curve and sets its vertices to `other`.
 		void set_vertices(const std::vector<glm::vec3>& other)
 		{
 			vertices = other;
+			cumulative_lengths_valid = false;
 		}
 		
 	private:
 
-		std::vector<glm::vec3> vertices;
+		/// Returns the point on the segment at `segment_index` that lies `length` units along
+		/// the curve (as measured from the first vertex).
+		glm::vec3 point_along_segment(size_t segment_index, float length) const
+		{
+			const auto& lengths = get_cumulative_lengths();
+			const auto segment_length = lengths[segment_index + 1] - lengths[segment_index];
 
-	};
+			if (segment_length <= 0.0f)
+			{
+				return vertices[segment_index];
+			}
 
-	/// Generates an extruded tube from the specified curve. Within the context of this program, an "extruded tube" is a thick, tubular mesh
-	/// with a circular cross-section of constant radius. 
-	std::vector<glm::vec3> generate_tube(const PolygonalCurve& curve, float radius = 0.5f, size_t number_of_segments = 10)
-	{
-		const auto circle_normal = glm::vec3{ 0.0f, 1.0f, 0.0f };
-		const auto circle_center = glm::vec3{};
-		std::vector<glm::vec3> tube_vertices;
+			const auto along_segment = fmin(fmax((length - lengths[segment_index]) / segment_length, 0.0f), 1.0f);
+
+			return get_segment(segment_index).point_at(along_segment);
+		}
 
-		auto v_prev = glm::vec3{ 0.0f, 0.0f, 0.0f };
+		/// Returns the angle (in radians) between the segments `a -> b` and `b -> c`, which is
+		/// `0` if the three points are collinear (and `a -> b -> c` doesn't double back).
+		static float turning_angle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+		{
+			const auto ab = b - a;
+			const auto bc = c - b;
+			const auto denominator = glm::length(ab) * glm::length(bc);
 
-		// Loop over all of the indices plus the last one to form a closed loop
-		for (size_t i = 0; i < curve.get_number_of_vertices() + 1; ++i)
-		{	
-			size_t center_index = i;
-			if (i == curve.get_number_of_vertices())
+			if (denominator < 1e-8f)
 			{
-				center_index = 0;
+				return 0.0f;
 			}
 
-			auto [neighbor_l_index, neighbor_r_index] = curve.get_neighboring_indices_wrapped(center_index);
+			return acosf(fmax(-1.0f, fmin(1.0f, glm::dot(ab, bc) / denominator)));
+		}
+
+		/// The vertices of a closed polyline that are still left during `refine`: `l[i]` and `r[i]` are the
+		/// neighbors of vertex `i`, which are only meaningful if the vertex hasn't been removed.
+		struct Links
+		{
+			std::vector<size_t> l;
+			std::vector<size_t> r;
+			std::vector<bool> is_removed;
+		};
+
+		/// A uniform grid that records which segments of a polyline pass near each of its cells, so that
+		/// `refine` only has to check the segments around a vertex before removing it. Each segment is 
+		/// added to every cell that its bounding box overlaps. Removing a vertex only ever lengthens the
+		/// segment to its left, so that segment is simply added again: the stale entries that this leaves 
+		/// behind (and the entries of removed segments) are skipped by whoever looks them up.
+		class SegmentGrid
+		{
 
-			// Grab the current vertex plus its two neighbors
-			auto center = curve.get_vertices()[center_index];
-			auto neighbor_l = curve.get_vertices()[neighbor_l_index];
-			auto neighbor_r = curve.get_vertices()[neighbor_r_index];
+		public:
 
-			auto towards_l = glm::normalize(neighbor_l - center); // Vector that points towards the left neighbor
-			auto towards_r = glm::normalize(neighbor_r - center); // Vector that points towards the right neighbor
-			
+			/// Creates an empty grid that covers `points`, with cells that are (at least) `cell_size` units
+			/// wide. The cells are made larger if needed, so that there are never many more cells than points.
+			SegmentGrid(const std::vector<glm::vec3>& points, float cell_size) :
+				origin{ points.empty() ? glm::vec3{} : points.front() },
+				cell_size{ std::max(cell_size, 1e-3f) }
+			{
+				auto max_point = origin;
+				for (const auto& point : points)
+				{
+					origin = glm::min(origin, point);
+					max_point = glm::max(max_point, point);
+				}
 
-			// Calculate the tangent vector at the current point along the polyline
-			auto diff = towards_r - towards_l;
-			float l2 = glm::length(towards_r - towards_l) * glm::length(towards_r - towards_l);
-			auto t = l2 > 0.0f ? glm::normalize(towards_r - towards_l) : -towards_l;
+				while (true)
+				{
+					for (size_t axis = 0; axis < 3; ++axis)
+					{
+						dimensions[axis] = static_cast<size_t>((max_point[axis] - origin[axis]) / this->cell_size) + 1;
+					}
+
+					if (dimensions[0] * dimensions[1] * dimensions[2] <= points.size() * 4 + 64)
+					{
+						break;
+					}
 
-			// Calculate the next `u` basis vector: find an arbitrary vector perpendicular to the first tangent vector
-			auto u = i == 0 ? glm::normalize(glm::cross(glm::vec3{ 0.0f, 0.0f, 1.0f }, t)) : glm::normalize(glm::cross(t, v_prev));
+					this->cell_size *= 2.0f;
+				}
 
-			// Calculate the next `v` basis vector
-			auto v = glm::normalize(glm::cross(u, t));
+				cells.resize(dimensions[0] * dimensions[1] * dimensions[2]);
+			}
 
-			for (size_t segment = 0; segment < number_of_segments; segment++)
+			/// Adds the segment at `segment_index` (from `a` to `b`) to all of the cells that it could pass through.
+			void insert(size_t segment_index, const glm::vec3& a, const glm::vec3& b)
 			{
-				float theta = 2.0f * M_PI * (segment / static_cast<float>(number_of_segments));
-				float x = radius * cosf(theta);
-				float y = radius * sinf(theta);
-				tube_vertices.push_back(u * x + v * y + center);
+				for_each_cell(glm::min(a, b), glm::max(a, b), [&](std::vector<size_t>& cell) {
+					cell.push_back(segment_index);
+					return true;
+				});
 			}
 
-			// Set the previous `v` vector to the current `v` vector (parallel transport)
-			v_prev = v;
-		}
+			/// Returns `true` if `predicate(segment_index)` holds for every segment that was added to the cells
+			/// that overlap the box between `min_point` and `max_point`, stopping early at the first one that doesn't.
+			/// Segments that span several of these cells are visited more than once.
+			template<typename Predicate>
+			bool all_of(const glm::vec3& min_point, const glm::vec3& max_point, Predicate predicate)
+			{
+				return for_each_cell(min_point, max_point, [&](const std::vector<size_t>& cell) {
+					return std::all_of(cell.begin(), cell.end(), predicate);
+				});
+			}
 
-		// Generate the final array of vertices, which are the triangles that enclose the
-		// tube extrusion: for now, we don't use indexed rendering
-		std::vector<glm::vec3> triangles;
+		private:
 
-		// The number of "rings" (i.e. circular cross-sections) that form the "skeleton" of the tube
-		auto number_of_rings = tube_vertices.size() / number_of_segments;
+			/// Calls `visit(cell)` for each cell that overlaps the box between `min_point` and `max_point` (clamped
+			/// to the grid), until it returns `false`. Returns `false` if it stopped early.
+			template<typename Visitor>
+			bool for_each_cell(const glm::vec3& min_point, const glm::vec3& max_point, Visitor visit)
+			{
+				std::array<size_t, 3> min_cell;
+				std::array<size_t, 3> max_cell;
+				for (size_t axis = 0; axis < 3; ++axis)
+				{
+					min_cell[axis] = get_cell(min_point[axis], axis);
+					max_cell[axis] = get_cell(max_point[axis], axis);
+				}
 
-		for (size_t ring_index = 0; ring_index < number_of_rings - 1; ring_index++)
-		{
-			auto next_ring_index = (ring_index + 1) % number_of_rings;
+				for (size_t z = min_cell[2]; z <= max_cell[2]; ++z)
+				{
+					for (size_t y = min_cell[1]; y <= max_cell[1]; ++y)
+					{
+						for (size_t x = min_cell[0]; x <= max_cell[0]; ++x)
+						{
+							if (!visit(cells[(z * dimensions[1] + y) * dimensions[0] + x]))
+							{
+								return false;
+							}
+						}
+					}
+				}
+
+				return true;
+			}
 
-			for (size_t local_index = 0; local_index < number_of_segments; local_index++)
+			/// Returns the index of the cell that contains `coordinate` along `axis`, clamped to the grid.
+			size_t get_cell(float coordinate, size_t axis) const
 			{
-				// Vertices are laid out in "rings" of `number_of_segments` vertices like
-				// so (for `number_of_segments = 6`):
-				//
-				// 6  7  8  9  ...
-				//
-				// 0  1  2  3  4  5
-				auto next_local_index = (local_index + 1) % number_of_segments;
-
-				// First triangle: 0 -> 6 -> 7
-				triangles.push_back(tube_vertices[ring_index * number_of_segments + local_index]);
-				triangles.push_back(tube_vertices[next_ring_index * number_of_segments + local_index]); // The next ring
-				triangles.push_back(tube_vertices[next_ring_index * number_of_segments + next_local_index]); // The next ring
-
-				// Second triangle: 0 -> 7 -> 1
-				triangles.push_back(tube_vertices[ring_index * number_of_segments + local_index]);
-				triangles.push_back(tube_vertices[next_ring_index * number_of_segments + next_local_index]); // The next ring
-				triangles.push_back(tube_vertices[ring_index * number_of_segments + next_local_index]);
+				const auto cell = floorf((coordinate - origin[axis]) / cell_size);
+				return static_cast<size_t>(glm::clamp(cell, 0.0f, static_cast<float>(dimensions[axis] - 1)));
 			}
+
+			glm::vec3 origin;
+			float cell_size;
+			std::array<size_t, 3> dimensions;
+			std::vector<std::vector<size_t>> cells;
+
+		};
+
+		/// Returns `true` if the vertex at `index` can be removed from the closed polyline
+		/// `points` (whose remaining vertices are described by `links`) without the resulting 
+		/// segment crossing (or, if `clearance` is non-zero, coming within `clearance` units of) 
+		/// any other segment. Only the segments in `grid` that are near the vertex are checked.
+		static bool can_remove_vertex(const std::vector<glm::vec3>& points, const Links& links, SegmentGrid& grid, size_t index, float clearance)
+		{
+			const auto prev_index = links.l[index];
+			const auto next_index = links.r[index];
+
+			const auto& prev = points[prev_index];
+			const auto& curr = points[index];
+			const auto& next = points[next_index];
+			const auto shortcut = Segment{ prev, next };
+
+			// Any segment that passes through the triangle (or comes within `clearance` of the shortcut) overlaps
+			// this box, give or take the tolerance of `intersects_triangle`
+			const auto margin = glm::vec3{ clearance + 1e-3f };
+			const auto min_point = glm::min(glm::min(prev, curr), next) - margin;
+			const auto max_point = glm::max(glm::max(prev, curr), next) + margin;
+
+			return grid.all_of(min_point, max_point, [&](size_t i) {
+				// Skip the two segments that will be removed, as well as the two segments that 
+				// share an endpoint with the new one (and any segments that are already gone)
+				if (links.is_removed[i] ||
+					i == links.l[prev_index] ||
+					i == prev_index ||
+					i == index ||
+					i == next_index)
+				{
+					return true;
+				}
+
+				const auto other = Segment{ points[i], points[links.r[i]] };
+
+				if (other.intersects_triangle(prev, curr, next))
+				{
+					return false;
+				}
+
+				if (clearance > 0.0f && glm::length(shortcut.shortest_distance_between(other)) < clearance)
+				{
+					return false;
+				}
+
+				return true;
+			});
 		}
 
-		return triangles;
-	}
+		std::vector<glm::vec3> vertices;
 
+		// Cached arc length table (see `get_cumulative_lengths`)
+		mutable std::vector<float> cumulative_lengths;
+		mutable bool cumulative_lengths_valid = false;
+
+	};
 
 }
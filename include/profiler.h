@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gpu_timer.h"
+
+namespace graphics
+{
+
+    /// Whether a stage is timed on the CPU (with a high-resolution clock) or on the GPU (with timer queries)
+    enum class StageClock
+    {
+        CPU,
+        GPU
+    };
+
+    struct ProfilerStage
+    {
+        std::string name;
+        StageClock clock;
+    };
+
+    /// Records how long each stage of the main loop takes, every frame, and keeps a rolling history of the last
+    /// `history_length` frames
+    ///
+    /// CPU stages can be entered several times per frame (their times are summed), while GPU stages must be entered
+    /// at most once per frame and never overlap (see `GpuTimer`). GPU times lag behind by a couple of frames, since
+    /// their queries are only read back once they have finished. Stages that didn't run during a frame record 0.
+    class Profiler
+    {
+    public:
+
+        /// The number of frames that are kept in each stage's history
+        static constexpr size_t history_length = 300;
+
+        Profiler(const std::vector<ProfilerStage>& stages) :
+            stages{ stages },
+            accumulated(stages.size(), 0.0f),
+            started(stages.size()),
+            ran(stages.size(), false),
+            history(stages.size(), std::vector<float>(history_length, 0.0f))
+        {
+            for (const auto& stage : stages)
+            {
+                timers.push_back(stage.clock == StageClock::GPU ? std::make_unique<GpuTimer>() : nullptr);
+            }
+        }
+
+        void begin(size_t stage)
+        {
+            if (timers[stage])
+            {
+                timers[stage]->begin();
+            }
+            else
+            {
+                started[stage] = std::chrono::high_resolution_clock::now();
+            }
+        }
+
+        void end(size_t stage)
+        {
+            if (timers[stage])
+            {
+                timers[stage]->end();
+                accumulated[stage] = timers[stage]->get_milliseconds();
+            }
+            else
+            {
+                const auto elapsed = std::chrono::high_resolution_clock::now() - started[stage];
+                accumulated[stage] += std::chrono::duration<float, std::milli>(elapsed).count();
+            }
+            ran[stage] = true;
+        }
+
+        /// Adds the times that were measured since the last call to each stage's history.
+        void end_frame()
+        {
+            for (size_t stage = 0; stage < stages.size(); ++stage)
+            {
+                history[stage][next_sample] = ran[stage] ? accumulated[stage] : 0.0f;
+                accumulated[stage] = 0.0f;
+                ran[stage] = false;
+            }
+
+            next_sample = (next_sample + 1) % history_length;
+            number_of_frames++;
+        }
+
+        const std::vector<ProfilerStage>& get_stages() const
+        {
+            return stages;
+        }
+
+        /// Returns the history of `stage` as a ring buffer, whose oldest sample is at `get_history_offset()`.
+        const std::vector<float>& get_history(size_t stage) const
+        {
+            return history[stage];
+        }
+
+        size_t get_history_offset() const
+        {
+            return next_sample;
+        }
+
+        /// Returns the most recent sample of `stage` (in milliseconds).
+        float get_latest(size_t stage) const
+        {
+            return history[stage][(next_sample + history_length - 1) % history_length];
+        }
+
+        /// Returns the average of `stage` over the frames in its history (in milliseconds).
+        float get_average(size_t stage) const
+        {
+            const auto count = std::min(number_of_frames, history_length);
+            if (count == 0)
+            {
+                return 0.0f;
+            }
+
+            float sum = 0.0f;
+            for (size_t i = 0; i < count; ++i)
+            {
+                sum += history[stage][(next_sample + history_length - 1 - i) % history_length];
+            }
+
+            return sum / count;
+        }
+
+        /// Returns the largest sample of `stage` in its history (in milliseconds).
+        float get_maximum(size_t stage) const
+        {
+            return *std::max_element(history[stage].begin(), history[stage].end());
+        }
+
+        /// Writes the history of every stage to the .csv file at `path`: one row per frame (oldest first) and one
+        /// column per stage, with all times in milliseconds.
+        void save_csv(const std::string& path) const
+        {
+            std::ofstream file{ path, std::ios::trunc };
+            if (!file.is_open())
+            {
+                throw std::runtime_error("Unable to open file for writing: " + path);
+            }
+
+            file << "frame";
+            for (const auto& stage : stages)
+            {
+                file << "," << stage.name << (stage.clock == StageClock::GPU ? " (GPU)" : "");
+            }
+            file << "\n";
+
+            const auto count = std::min(number_of_frames, history_length);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto sample = (next_sample + history_length - count + i) % history_length;
+
+                file << number_of_frames - count + i;
+                for (size_t stage = 0; stage < stages.size(); ++stage)
+                {
+                    file << "," << history[stage][sample];
+                }
+                file << "\n";
+            }
+
+            file.flush();
+            if (!file)
+            {
+                throw std::runtime_error("Failed to write file: " + path);
+            }
+        }
+
+    private:
+
+        std::vector<ProfilerStage> stages;
+        std::vector<std::unique_ptr<GpuTimer>> timers;
+
+        // The time spent in each stage during the current frame, and when each (CPU) stage was last entered
+        std::vector<float> accumulated;
+        std::vector<std::chrono::high_resolution_clock::time_point> started;
+        std::vector<bool> ran;
+
+        std::vector<std::vector<float>> history;
+        size_t next_sample = 0;
+        size_t number_of_frames = 0;
+    };
+
+}
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "glad/glad.h"
 
@@ -13,8 +15,24 @@ namespace graphics
 
     struct UniformEntry
     {
-        uint32_t location;
+        int32_t location;
         uint32_t count;
+        GLenum type;
+    };
+
+    /// A handle to a uniform of type `T` (e.g. `glm::mat4`) in a particular shader program: resolve it once with
+    /// `Shader::resolve`, then set it as often as needed with `Shader::set`, without any further name lookups
+    template<typename T>
+    struct Uniform
+    {
+        // The location of the uniform (or -1 if the program has no active uniform with this name, in which case
+        // setting it does nothing)
+        int32_t location = -1;
+
+        bool is_valid() const
+        {
+            return location != -1;
+        }
     };
 
     class Shader
@@ -33,6 +51,7 @@ namespace graphics
             glAttachShader(program_id, frag);
             glLinkProgram(program_id);
             check_compilation_errors(program_id, "program");
+            perform_reflection();
 
             glDeleteShader(vert);
             glDeleteShader(frag);
@@ -48,6 +67,7 @@ namespace graphics
             glAttachShader(program_id, comp);
             glLinkProgram(program_id);
             check_compilation_errors(program_id, "program");
+            perform_reflection();
 
             glDeleteShader(comp);
         }
@@ -75,61 +95,127 @@ namespace graphics
             return { local_size[0], local_size[1], local_size[2] };
         }
 
+        /// Returns all of the active uniforms in this program (found when it was linked), keyed by name.
+        const std::unordered_map<std::string, UniformEntry>& get_uniforms() const
+        {
+            return uniforms;
+        }
+
+        /// Looks up the uniform called `name` (in the table that was built when this program was linked). In debug 
+        /// builds, a warning is printed (once per name) if there is no such active uniform.
+        template<typename T>
+        Uniform<T> resolve(const std::string& name) const
+        {
+            return { find_location(name) };
+        }
+
+        // Typed setters, which use DSA (i.e. they don't require this program to be bound)
+        void set(Uniform<bool> uniform, bool value) const
+        {
+            glProgramUniform1i(program_id, uniform.location, (int)value);
+        }
+
+        void set(Uniform<int> uniform, int value) const
+        {
+            glProgramUniform1i(program_id, uniform.location, value);
+        }
+
+        void set(Uniform<float> uniform, float value) const
+        {
+            glProgramUniform1f(program_id, uniform.location, value);
+        }
+
+        void set(Uniform<glm::vec2> uniform, const glm::vec2& value) const
+        {
+            glProgramUniform2fv(program_id, uniform.location, 1, &value[0]);
+        }
+
+        void set(Uniform<glm::ivec2> uniform, const glm::ivec2& value) const
+        {
+            glProgramUniform2iv(program_id, uniform.location, 1, &value[0]);
+        }
+
+        void set(Uniform<glm::vec3> uniform, const glm::vec3& value) const
+        {
+            glProgramUniform3fv(program_id, uniform.location, 1, &value[0]);
+        }
+
+        void set(Uniform<glm::vec4> uniform, const glm::vec4& value) const
+        {
+            glProgramUniform4fv(program_id, uniform.location, 1, &value[0]);
+        }
+
+        void set(Uniform<glm::mat2> uniform, const glm::mat2& mat) const
+        {
+            glProgramUniformMatrix2fv(program_id, uniform.location, 1, GL_FALSE, &mat[0][0]);
+        }
+
+        void set(Uniform<glm::mat3> uniform, const glm::mat3& mat) const
+        {
+            glProgramUniformMatrix3fv(program_id, uniform.location, 1, GL_FALSE, &mat[0][0]);
+        }
+
+        void set(Uniform<glm::mat4> uniform, const glm::mat4& mat) const
+        {
+            glProgramUniformMatrix4fv(program_id, uniform.location, 1, GL_FALSE, &mat[0][0]);
+        }
+
+        // Name-based setters, which look up the location of the uniform every time (via the cache)
         void uniform_bool(const std::string& name, bool value) const
         {
-            glUniform1i(glGetUniformLocation(program_id, name.c_str()), (int)value);
+            set(resolve<bool>(name), value);
         }
 
         void uniform_int(const std::string& name, int value) const
         {
-            glUniform1i(glGetUniformLocation(program_id, name.c_str()), value);
+            set(resolve<int>(name), value);
         }
 
         void uniform_float(const std::string& name, float value) const
         {
-            glUniform1f(glGetUniformLocation(program_id, name.c_str()), value);
+            set(resolve<float>(name), value);
         }
 
         void uniform_vec2(const std::string& name, const glm::vec2& value) const
         {
-            glUniform2fv(glGetUniformLocation(program_id, name.c_str()), 1, &value[0]);
+            set(resolve<glm::vec2>(name), value);
         }
         void uniform_vec2(const std::string& name, float x, float y) const
         {
-            glUniform2f(glGetUniformLocation(program_id, name.c_str()), x, y);
+            set(resolve<glm::vec2>(name), glm::vec2{ x, y });
         }
 
         void uniform_vec3(const std::string& name, const glm::vec3& value) const
         {
-            glUniform3fv(glGetUniformLocation(program_id, name.c_str()), 1, &value[0]);
+            set(resolve<glm::vec3>(name), value);
         }
         void uniform_vec3(const std::string& name, float x, float y, float z) const
         {
-            glUniform3f(glGetUniformLocation(program_id, name.c_str()), x, y, z);
+            set(resolve<glm::vec3>(name), glm::vec3{ x, y, z });
         }
 
         void uniform_vec4(const std::string& name, const glm::vec4& value) const
         {
-            glUniform4fv(glGetUniformLocation(program_id, name.c_str()), 1, &value[0]);
+            set(resolve<glm::vec4>(name), value);
         }
-        void uniform_vec4(const std::string& name, float x, float y, float z, float w)
+        void uniform_vec4(const std::string& name, float x, float y, float z, float w) const
         {
-            glUniform4f(glGetUniformLocation(program_id, name.c_str()), x, y, z, w);
+            set(resolve<glm::vec4>(name), glm::vec4{ x, y, z, w });
         }
 
         void uniform_mat2(const std::string& name, const glm::mat2& mat) const
         {
-            glUniformMatrix2fv(glGetUniformLocation(program_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            set(resolve<glm::mat2>(name), mat);
         }
 
         void uniform_mat3(const std::string& name, const glm::mat3& mat) const
         {
-            glUniformMatrix3fv(glGetUniformLocation(program_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            set(resolve<glm::mat3>(name), mat);
         }
 
         void uniform_mat4(const std::string& name, const glm::mat4& mat) const
         {
-            glUniformMatrix4fv(glGetUniformLocation(program_id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            set(resolve<glm::mat4>(name), mat);
         }
 
     private:
@@ -137,6 +223,26 @@ namespace graphics
         uint32_t program_id;
         std::unordered_map<std::string, UniformEntry> uniforms;
 
+        // Names that have already been warned about (see `find_location`)
+        mutable std::unordered_set<std::string> unknown_uniforms;
+
+        int32_t find_location(const std::string& name) const
+        {
+            const auto found = uniforms.find(name);
+            if (found != uniforms.end())
+            {
+                return found->second.location;
+            }
+
+#if defined(_DEBUG)
+            if (unknown_uniforms.insert(name).second)
+            {
+                std::cerr << "Warning: shader program " << program_id << " has no active uniform called " << name << "\n";
+            }
+#endif
+            return -1;
+        }
+
         std::string get_shader_type(uint32_t type)
         {
             switch (type)
@@ -215,8 +321,12 @@ namespace graphics
             }
         }
 
+        /// Builds the table of active uniforms (and their locations), so that uniforms never have to be looked up
+        /// by name through the driver.
         void perform_reflection()
         {
+            uniforms.clear();
+
             GLint uniform_count = 0;
             glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &uniform_count);
 
@@ -230,17 +340,30 @@ namespace graphics
 
                 auto uniform_name = std::make_unique<char[]>(max_name_len);
 
-                std::unordered_map<std::string, UniformEntry> uniforms;
-
-                for (size_t i = 0; i < uniform_count; ++i)
+                for (GLint i = 0; i < uniform_count; ++i)
                 {
                     glGetActiveUniform(program_id, i, max_name_len, &length, &count, &type, uniform_name.get());
 
                     UniformEntry uniform_info = {};
                     uniform_info.location = glGetUniformLocation(program_id, uniform_name.get());
                     uniform_info.count = count;
-
-                    uniforms.emplace(std::make_pair(std::string(uniform_name.get(), length), uniform_info));
+                    uniform_info.type = type;
+
+                    // Uniforms in blocks don't have locations
+                    if (uniform_info.location == -1)
+                    {
+                        continue;
+                    }
+
+                    auto name = std::string(uniform_name.get(), length);
+                    uniforms.emplace(name, uniform_info);
+
+                    // Arrays are reported as "name[0]", but can also be referred to as just "name"
+                    const auto suffix = std::string{ "[0]" };
+                    if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+                    {
+                        uniforms.emplace(name.substr(0, name.size() - suffix.size()), uniform_info);
+                    }
                 }
             }
         }
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace utils
+{
+
+	/// A fixed-size pool of worker threads with one task queue per worker: idle workers
+	/// "steal" tasks from the queues of busy workers, so that a handful of expensive tasks
+	/// doesn't leave the rest of the pool waiting around
+	///
+	/// Tasks are (roughly) started in the order that they were submitted, so callers that
+	/// know the relative cost of their tasks should submit the most expensive ones first
+	///
+	/// An exception that escapes a task doesn't take down its worker: the first one is kept
+	/// and rethrown by the next call to `wait` (once every task has finished)
+	///
+	/// Each queue is a ring buffer that only grows (and never shrinks), so once a pool has seen
+	/// its largest batch, submitting tasks doesn't allocate (as long as each task is small
+	/// enough for `std::function` to store it inline, e.g. a lambda that captures a couple of
+	/// references)
+	class ThreadPool
+	{
+
+	public:
+
+		using Task = std::function<void()>;
+
+		ThreadPool(size_t number_of_threads = std::thread::hardware_concurrency())
+		{
+			number_of_threads = std::max(number_of_threads, size_t{ 1 });
+
+			for (size_t i = 0; i < number_of_threads; ++i)
+			{
+				queues.push_back(std::make_unique<WorkerQueue>());
+			}
+
+			for (size_t i = 0; i < number_of_threads; ++i)
+			{
+				workers.emplace_back([this, i] { run(i); });
+			}
+		}
+
+		ThreadPool(const ThreadPool& other) = delete;
+
+		ThreadPool& operator=(const ThreadPool& other) = delete;
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				stopping = true;
+			}
+			task_available.notify_all();
+
+			for (auto& worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		/// Returns the number of worker threads in this pool.
+		size_t get_number_of_threads() const
+		{
+			return workers.size();
+		}
+
+		/// Adds a new task to the pool: tasks are distributed across the worker queues in a
+		/// round-robin fashion.
+		void submit(Task task)
+		{
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+
+				// Count the task before pushing it, so that `queued` never underflows
+				queued++;
+				pending++;
+
+				auto& queue = *queues[next_queue];
+				next_queue = (next_queue + 1) % queues.size();
+
+				std::lock_guard<std::mutex> queue_lock{ queue.mutex };
+				queue.tasks.push_back(std::move(task));
+			}
+			task_available.notify_one();
+		}
+
+		/// Blocks until every task that has been submitted so far has finished running, then
+		/// rethrows the first exception that escaped any of them (if there was one).
+		void wait()
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			all_finished.wait(lock, [this] { return pending == 0; });
+
+			if (first_exception)
+			{
+				std::rethrow_exception(std::exchange(first_exception, nullptr));
+			}
+		}
+
+	private:
+
+		/// A first-in, first-out queue of tasks, stored in a ring buffer that doubles in size when it is full.
+		class TaskRing
+		{
+
+		public:
+
+			bool empty() const
+			{
+				return size == 0;
+			}
+
+			void push_back(Task task)
+			{
+				if (size == slots.size())
+				{
+					grow();
+				}
+
+				slots[(front + size) % slots.size()] = std::move(task);
+				size++;
+			}
+
+			Task pop_front()
+			{
+				auto task = std::move(slots[front]);
+				slots[front] = nullptr;
+				front = (front + 1) % slots.size();
+				size--;
+
+				return task;
+			}
+
+		private:
+
+			void grow()
+			{
+				std::vector<Task> grown(std::max(slots.size() * 2, size_t{ 16 }));
+				for (size_t i = 0; i < size; ++i)
+				{
+					grown[i] = std::move(slots[(front + i) % slots.size()]);
+				}
+
+				slots = std::move(grown);
+				front = 0;
+			}
+
+			std::vector<Task> slots;
+			size_t front = 0;
+			size_t size = 0;
+
+		};
+
+		struct WorkerQueue
+		{
+			TaskRing tasks;
+			std::mutex mutex;
+		};
+
+		/// Tries to take the oldest task from the queue at `queue_index`.
+		bool try_pop(size_t queue_index, Task& task)
+		{
+			auto& queue = *queues[queue_index];
+			std::lock_guard<std::mutex> lock{ queue.mutex };
+
+			if (queue.tasks.empty())
+			{
+				return false;
+			}
+
+			task = queue.tasks.pop_front();
+			queued--;
+
+			return true;
+		}
+
+		/// The main loop of the worker at `worker_index`: run tasks from its own queue, and
+		/// once that is empty, steal tasks from the other workers' queues.
+		void run(size_t worker_index)
+		{
+			while (true)
+			{
+				Task task;
+				bool found = try_pop(worker_index, task);
+
+				for (size_t offset = 1; offset < queues.size() && !found; ++offset)
+				{
+					found = try_pop((worker_index + offset) % queues.size(), task);
+				}
+
+				if (found)
+				{
+					std::exception_ptr exception;
+					try
+					{
+						task();
+					}
+					catch (...)
+					{
+						exception = std::current_exception();
+					}
+
+					std::lock_guard<std::mutex> lock{ mutex };
+					if (exception && !first_exception)
+					{
+						first_exception = exception;
+					}
+					if (--pending == 0)
+					{
+						all_finished.notify_all();
+					}
+
+					continue;
+				}
+
+				// Nothing to do: sleep until a new task is submitted (or the pool is destroyed)
+				std::unique_lock<std::mutex> lock{ mutex };
+				task_available.wait(lock, [this] { return stopping || queued > 0; });
+
+				if (stopping && queued == 0)
+				{
+					return;
+				}
+			}
+		}
+
+		// One task queue per worker thread
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+		// The worker threads
+		std::vector<std::thread> workers;
+
+		// Guards `next_queue`, `pending`, `stopping`, and `first_exception` (and is used to put idle workers to sleep)
+		std::mutex mutex;
+		std::condition_variable task_available;
+		std::condition_variable all_finished;
+
+		// The queue that the next submitted task will be pushed onto
+		size_t next_queue = 0;
+
+		// The number of tasks that are sitting in a queue, waiting to be picked up
+		std::atomic<size_t> queued{ 0 };
+
+		// The number of tasks that have been submitted but haven't finished running yet
+		size_t pending = 0;
+
+		// Whether or not the pool is shutting down
+		bool stopping = false;
+
+		// The first exception that escaped a task since the last call to `wait`
+		std::exception_ptr first_exception;
+
+	};
+
+}
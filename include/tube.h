@@ -0,0 +1,662 @@
+#pragma once
+
+#define _USE_MATH_DEFINES
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory_resource>
+#include <vector>
+
+#include "glm.hpp"
+
+#include "polygonal_curve.h"
+#include "thread_pool.h"
+
+namespace geom
+{
+
+	/// A circular cross-section ("ring") of an extruded tube, which is fully described by its center and two basis vectors
+	struct TubeRing
+	{
+		glm::vec3 center;
+		glm::vec3 u;
+		glm::vec3 v;
+
+		/// Returns the `segment`-th of the `number_of_segments` vertices that are evenly spaced around this ring.
+		glm::vec3 vertex(size_t segment, size_t number_of_segments, float radius) const
+		{
+			float theta = 2.0f * M_PI * (segment / static_cast<float>(number_of_segments));
+			float x = radius * cosf(theta);
+			float y = radius * sinf(theta);
+			return u * x + v * y + center;
+		}
+	};
+
+	/// Returns the number of vertices in the (non-indexed) triangle mesh that `generate_tube` builds for a curve
+	/// with `number_of_vertices` vertices: each pair of adjacent rings is joined by `number_of_segments` quads,
+	/// and each quad is made of 2 triangles.
+	inline size_t get_tube_vertex_count(size_t number_of_vertices, size_t number_of_segments = 10)
+	{
+		return number_of_vertices * number_of_segments * 6;
+	}
+
+	/// Returns the number of (unique) vertices in the indexed tube mesh that `generate_tube_vertices` builds for
+	/// a curve with `number_of_vertices` vertices: `number_of_segments` vertices for each of the rings.
+	inline size_t get_tube_ring_vertex_count(size_t number_of_vertices, size_t number_of_segments = 10)
+	{
+		return (number_of_vertices + 1) * number_of_segments;
+	}
+
+	/// Returns the number of indices in the indexed tube mesh (see `generate_tube_indices`), which is the same
+	/// as the number of vertices in the non-indexed mesh.
+	inline size_t get_tube_index_count(size_t number_of_vertices, size_t number_of_segments = 10)
+	{
+		return get_tube_vertex_count(number_of_vertices, number_of_segments);
+	}
+
+	/// A level of detail for tube meshes whose rings are placed adaptively (see `write_adaptive_ring_centers`)
+	struct TubeDetail
+	{
+		// The number of rings, relative to the number of vertices in the curve
+		float ring_ratio;
+
+		// The number of vertices around each ring
+		size_t number_of_segments;
+	};
+
+	/// The available levels of detail, from finest to coarsest. The finest has one ring per vertex, so it is the same
+	/// as the tube from `write_vertices`.
+	constexpr std::array<TubeDetail, 3> tube_details = { { { 1.0f, 10 }, { 0.5f, 8 }, { 0.25f, 6 } } };
+
+	/// Returns the number of rings that a tube around a curve with `number_of_vertices` vertices has at the
+	/// level of detail `detail`. This only depends on the number of vertices, so (like the indices) it stays 
+	/// fixed for as long as the topology of the curve does.
+	inline size_t get_tube_ring_count(size_t number_of_vertices, const TubeDetail& detail)
+	{
+		const auto rings = static_cast<size_t>(ceilf(number_of_vertices * detail.ring_ratio));
+
+		// Very coarse tubes around small curves would collapse, so always keep a handful of rings
+		return std::max({ rings, std::min(number_of_vertices, size_t{ 8 }), size_t{ 3 } });
+	}
+
+	/// Returns the radius (in pixels) of a tube with radius `radius` that is `distance` units away from a
+	/// perspective camera with a vertical field of view of `fov_y` (in radians) and a viewport that is
+	/// `viewport_height` pixels tall.
+	inline float get_projected_radius(float radius, float distance, float fov_y, float viewport_height)
+	{
+		return radius / (std::max(distance, 1e-4f) * tanf(fov_y * 0.5f)) * (viewport_height * 0.5f);
+	}
+
+	/// Returns the index (into `tube_details`) of the coarsest level of detail whose rings still look round 
+	/// when the tube's radius is `projected_radius` pixels on screen, i.e. whose edges around each ring are at 
+	/// most `maximum_edge_length` pixels long. Falls back to the finest level if none of them are fine enough.
+	inline size_t select_tube_detail(float projected_radius, float maximum_edge_length = 12.0f)
+	{
+		for (size_t level = tube_details.size(); level-- > 0;)
+		{
+			const auto edge_length = 2.0f * static_cast<float>(M_PI) * projected_radius / tube_details[level].number_of_segments;
+			if (edge_length <= maximum_edge_length)
+			{
+				return level;
+			}
+		}
+
+		return 0;
+	}
+
+	/// Writes `number_of_rings` points along `curve` to `destination`, which can be used as the centers of
+	/// the rings of a tube with curvature-adaptive spacing. Each point is one of the curve's vertices, so the
+	/// tube follows the curve through all of them. They are picked like so:
+	///
+	///		- Every "corner" (a vertex where the curve turns through at least `corner_angle` radians) gets a ring,
+	///		  so the tube never cuts across a significant bend
+	///		- The remaining rings are spread out over the other vertices by cost: each vertex costs half of the
+	///		  length of the segments next to it, plus `bend_length` units per radian that the curve turns through
+	///		  there, so straight runs get few rings and gentle bends get more
+	///
+	/// If there are more corners than rings, the rings are spread out over the corners by cost instead. With one
+	/// ring per vertex, every vertex is used (i.e. the tube is the same as the one from `write_vertices`). Tiny
+	/// curves with fewer vertices than rings get the extra rings spaced evenly along their segments. Returns the 
+	/// iterator one past the last point that was written.
+	template<typename OutputIterator>
+	OutputIterator write_adaptive_ring_centers(const PolygonalCurve& curve, size_t number_of_rings, float bend_length, OutputIterator destination, float corner_angle = 0.35f)
+	{
+		const auto number_of_vertices = curve.get_number_of_vertices();
+		if (number_of_vertices == 0 || number_of_rings == 0)
+		{
+			return destination;
+		}
+
+		const auto& vertices = curve.get_vertices();
+
+		if (number_of_rings >= number_of_vertices)
+		{
+			const auto extra_rings = number_of_rings - number_of_vertices;
+			for (size_t i = 0; i < number_of_vertices; ++i)
+			{
+				*destination++ = vertices[i];
+
+				// This segment's share of the extra rings
+				const auto count = extra_rings * (i + 1) / number_of_vertices - extra_rings * i / number_of_vertices;
+				for (size_t k = 1; k <= count; ++k)
+				{
+					*destination++ = glm::lerp(vertices[i], vertices[curve.get_wrapped_index(i + 1)], k / (count + 1.0f));
+				}
+			}
+
+			return destination;
+		}
+
+		const auto is_corner = [&](size_t i) {
+			return curve.get_turning_angle(i) >= corner_angle;
+		};
+		const auto get_cost = [&](size_t i) {
+			const auto [neighbor_l_index, neighbor_r_index] = curve.get_neighboring_indices_wrapped(i);
+			const auto half_lengths = 0.5f * (glm::distance(vertices[neighbor_l_index], vertices[i]) + glm::distance(vertices[i], vertices[neighbor_r_index]));
+
+			return half_lengths + bend_length * curve.get_turning_angle(i);
+		};
+
+		size_t number_of_corners = 0;
+		for (size_t i = 0; i < number_of_vertices; ++i)
+		{
+			number_of_corners += is_corner(i) ? 1 : 0;
+		}
+
+		// Either all of the corners get a ring and the other vertices compete for the rest, or (if there aren't
+		// enough rings to go around) only the corners compete
+		const bool keep_corners = number_of_corners <= number_of_rings;
+		const auto is_candidate = [&](size_t i) {
+			return is_corner(i) != keep_corners;
+		};
+
+		size_t number_of_candidates = 0;
+		float total_cost = 0.0f;
+		for (size_t i = 0; i < number_of_vertices; ++i)
+		{
+			if (is_candidate(i))
+			{
+				number_of_candidates++;
+				total_cost += get_cost(i);
+			}
+		}
+
+		// Candidates are picked where the running cost passes the marks at `(k + 0.5) * spacing`. A vertex whose cost 
+		// covers several marks can only be picked once, so the rest are "owed" to the vertices after it, and if there 
+		// are only just enough candidates left, all of them are picked.
+		const auto number_to_pick = keep_corners ? number_of_rings - number_of_corners : number_of_rings;
+		const auto spacing = number_to_pick > 0 ? total_cost / number_to_pick : 0.0f;
+		const auto get_mark = [&](float cost) {
+			return spacing > 0.0f ? static_cast<size_t>(cost / spacing + 0.5f) : size_t{ 0 };
+		};
+
+		size_t picked = 0;
+		size_t remaining = number_of_candidates;
+		size_t owed = 0;
+		float cost = 0.0f;
+
+		for (size_t i = 0; i < number_of_vertices; ++i)
+		{
+			if (!is_candidate(i))
+			{
+				if (keep_corners)
+				{
+					*destination++ = vertices[i];
+				}
+				continue;
+			}
+
+			const auto cost_next = cost + get_cost(i);
+			owed += get_mark(cost_next) - get_mark(cost);
+			cost = cost_next;
+
+			if (picked < number_to_pick && (owed > 0 || remaining == number_to_pick - picked))
+			{
+				*destination++ = vertices[i];
+				picked++;
+				owed -= owed > 0 ? 1 : 0;
+			}
+			remaining--;
+		}
+
+		return destination;
+	}
+
+	/// Computes the rings of an extruded tube around a closed curve, using rotation-minimizing frames
+	///
+	/// Frames are carried from one vertex to the next with the "double reflection" method (Wang et al.,
+	/// "Computation of Rotation Minimizing Frames"). Each step is a rotation that only depends on the curve
+	/// itself (not on the frame that it is applied to), so the curve is split into fixed-size chunks and:
+	///
+	///		1. The rotation across each chunk is computed (in parallel)
+	///		2. These rotations are chained together to find the frame at the start of each chunk (serially,
+	///		   but there is only one rotation per chunk)
+	///		3. The frames within each chunk are filled in (in parallel)
+	///
+	/// After one trip around the curve, the frame generally doesn't line up with where it started (its
+	/// "holonomy"), so the leftover twist is spread out evenly (by arc length) along the whole curve, which
+	/// makes the last ring match the first one and closes the seam.
+	///
+	/// The chunks don't depend on the number of threads, so the results are identical with or without a pool.
+	/// A builder holds onto its scratch memory, so reusing the same one (e.g. every frame) doesn't allocate.
+	class TubeBuilder
+	{
+
+	public:
+
+		/// The number of rings in each chunk of work.
+		static constexpr size_t chunk_size = 2048;
+
+		/// Creates a builder that spreads its work across the threads of `pool` (or runs on the calling thread
+		/// if `pool` is `nullptr`). Curves with fewer than `chunk_size` vertices are always handled serially.
+		/// The builder's scratch memory comes from `scratch`, so a short-lived builder can use a frame arena.
+		TubeBuilder(utils::ThreadPool* pool = nullptr, std::pmr::memory_resource* scratch = std::pmr::get_default_resource()) :
+			pool{ pool },
+			chunk_rotations{ scratch },
+			chunk_references{ scratch },
+			ring_offsets{ scratch }
+		{}
+
+		/// Calls `visit(ring_index, ring)` for each of the `n + 1` rings of a tube around `curve`: there is one ring
+		/// per vertex, plus a final ring (centered on the first vertex again) that closes the loop. Without a pool,
+		/// rings are visited in order. With one, chunks of rings are visited concurrently, so `visit` must be safe
+		/// to call from several threads at once.
+		template<typename Visitor>
+		void visit_rings(const PolygonalCurve& curve, Visitor visit)
+		{
+			const auto number_of_vertices = curve.get_number_of_vertices();
+			if (number_of_vertices < 2)
+			{
+				return;
+			}
+
+			// The arc length table is built lazily, so make sure that happens before any of the workers need it
+			const auto& lengths = curve.get_cumulative_lengths();
+
+			const auto number_of_chunks = (number_of_vertices + chunk_size - 1) / chunk_size;
+			const auto chunk_begin = [&](size_t chunk) { return chunk * chunk_size; };
+			const auto chunk_end = [&](size_t chunk) { return std::min((chunk + 1) * chunk_size, number_of_vertices); };
+
+			// Step 1: the rotation that carries a frame from the start of each chunk to the start of the next one
+			chunk_rotations.resize(number_of_chunks);
+			run_chunks(number_of_chunks, [&](size_t chunk) {
+				auto rotation = glm::mat3{ 1.0f };
+				for (size_t i = chunk_begin(chunk); i < chunk_end(chunk); ++i)
+				{
+					const auto step = Step{ curve, i };
+					rotation = glm::mat3{ step.apply(rotation[0]), step.apply(rotation[1]), step.apply(rotation[2]) };
+				}
+
+				chunk_rotations[chunk] = rotation;
+			});
+
+			// Step 2: the reference vector at the start of each chunk, plus the one that arrives back at the first vertex
+			const auto tangent_start = get_tangent(curve, 0);
+
+			chunk_references.resize(number_of_chunks + 1);
+			chunk_references[0] = get_initial_reference(tangent_start);
+			for (size_t chunk = 0; chunk < number_of_chunks; ++chunk)
+			{
+				const auto tangent = get_tangent(curve, chunk_end(chunk) % number_of_vertices);
+				chunk_references[chunk + 1] = make_perpendicular(chunk_rotations[chunk] * chunk_references[chunk], tangent);
+			}
+
+			// The signed angle (about the tangent) between where the frame started and where it ended up
+			const auto& reference_start = chunk_references.front();
+			const auto& reference_end = chunk_references.back();
+			const float holonomy = atan2f(glm::dot(glm::cross(reference_start, reference_end), tangent_start), glm::dot(reference_start, reference_end));
+
+			// Step 3: transport the frame through each chunk, undoing the holonomy bit by bit along the way
+			run_chunks(number_of_chunks, [&](size_t chunk) {
+				// The last chunk also takes care of the closing ring
+				const auto last_ring = chunk + 1 == number_of_chunks ? number_of_vertices : chunk_end(chunk) - 1;
+
+				auto reference = chunk_references[chunk];
+				for (size_t i = chunk_begin(chunk); i <= last_ring; ++i)
+				{
+					const auto center_index = i % number_of_vertices;
+					const auto tangent = get_tangent(curve, center_index);
+
+					if (i > chunk_begin(chunk))
+					{
+						reference = make_perpendicular(Step{ curve, i - 1 }.apply(reference), tangent);
+					}
+
+					const float correction = -holonomy * (lengths[i] / lengths.back());
+					const auto u = glm::normalize(reference * cosf(correction) + glm::cross(tangent, reference) * sinf(correction));
+					const auto v = glm::normalize(glm::cross(u, tangent));
+
+					visit(i, TubeRing{ curve.get_vertices()[center_index], u, v });
+				}
+			});
+		}
+
+		/// Writes the ring vertices of a tube around `curve` to `destination` (see `write_tube_vertices`), which must
+		/// be a random access iterator (for example, a pointer into a mapped GPU buffer), since the rings may be
+		/// written out of order.
+		template<typename RandomAccessIterator>
+		void write_vertices(const PolygonalCurve& curve, RandomAccessIterator destination, float radius = 0.5f, size_t number_of_segments = 10)
+		{
+			// Each ring vertex is `u * x + v * y + center`, where only `x` and `y` depend on the segment
+			ring_offsets.resize(number_of_segments);
+			for (size_t segment = 0; segment < number_of_segments; ++segment)
+			{
+				float theta = 2.0f * M_PI * (segment / static_cast<float>(number_of_segments));
+				ring_offsets[segment] = { radius * cosf(theta), radius * sinf(theta) };
+			}
+
+			visit_rings(curve, [&](size_t ring_index, const TubeRing& ring) {
+				auto ring_destination = destination + ring_index * number_of_segments;
+				for (const auto& offset : ring_offsets)
+				{
+					*ring_destination++ = ring.u * offset.x + ring.v * offset.y + ring.center;
+				}
+			});
+		}
+
+		/// Writes the ring vertices of a tube around `curve` at the level of detail `detail` to `destination`: first,
+		/// `get_tube_ring_count(...)` ring centers are placed along the curve (see `write_adaptive_ring_centers`), then 
+		/// a tube is built around them. The ring vertices can be indexed with `write_tube_indices(ring_count, ...)`.
+		template<typename RandomAccessIterator>
+		void write_adaptive_vertices(const PolygonalCurve& curve, RandomAccessIterator destination, const TubeDetail& detail, float radius = 0.5f, float bend_length = 2.0f, float corner_angle = 0.35f)
+		{
+			const auto number_of_rings = get_tube_ring_count(curve.get_number_of_vertices(), detail);
+
+			adaptive_centers.clear();
+			write_adaptive_ring_centers(curve, number_of_rings, bend_length, std::back_inserter(adaptive_centers), corner_angle);
+			adaptive_curve.set_vertices(adaptive_centers);
+
+			write_vertices(adaptive_curve, destination, radius, detail.number_of_segments);
+		}
+
+	private:
+
+		/// A single double reflection step, which carries a frame from vertex `i` to vertex `i + 1` (wrapping around).
+		struct Step
+		{
+			Step(const PolygonalCurve& curve, size_t i)
+			{
+				const auto j = curve.get_wrapped_index(i + 1);
+				const auto t_i = get_tangent(curve, i);
+				const auto t_j = get_tangent(curve, j);
+
+				// First reflection: in the plane that bisects the segment between the two vertices
+				reflection_a = curve.get_vertices()[j] - curve.get_vertices()[i];
+				const float length_a = glm::dot(reflection_a, reflection_a);
+				scale_a = length_a > 0.0f ? 2.0f / length_a : 0.0f;
+
+				// Second reflection: the one that lines the (reflected) tangent up with the next tangent
+				reflection_b = t_j - reflect(t_i, reflection_a, scale_a);
+				const float length_b = glm::dot(reflection_b, reflection_b);
+				scale_b = length_b > 1e-12f ? 2.0f / length_b : 0.0f;
+			}
+
+			glm::vec3 apply(const glm::vec3& x) const
+			{
+				return reflect(reflect(x, reflection_a, scale_a), reflection_b, scale_b);
+			}
+
+			static glm::vec3 reflect(const glm::vec3& x, const glm::vec3& normal, float scale)
+			{
+				return x - normal * (scale * glm::dot(normal, x));
+			}
+
+			glm::vec3 reflection_a;
+			glm::vec3 reflection_b;
+			float scale_a;
+			float scale_b;
+		};
+
+		/// Returns the tangent vector of `curve` at the vertex at `index`.
+		static glm::vec3 get_tangent(const PolygonalCurve& curve, size_t index)
+		{
+			const auto [neighbor_l_index, neighbor_r_index] = curve.get_neighboring_indices_wrapped(index);
+
+			const auto& center = curve.get_vertices()[index];
+			const auto towards_l = glm::normalize(curve.get_vertices()[neighbor_l_index] - center);
+			const auto towards_r = glm::normalize(curve.get_vertices()[neighbor_r_index] - center);
+
+			const auto bisector = towards_r - towards_l;
+			return glm::dot(bisector, bisector) > 0.0f ? glm::normalize(bisector) : -towards_l;
+		}
+
+		/// Returns an arbitrary unit vector perpendicular to `tangent`.
+		static glm::vec3 get_initial_reference(const glm::vec3& tangent)
+		{
+			const auto reference = glm::cross(glm::vec3{ 0.0f, 0.0f, 1.0f }, tangent);
+			if (glm::dot(reference, reference) > 1e-6f)
+			{
+				return glm::normalize(reference);
+			}
+
+			return glm::normalize(glm::cross(glm::vec3{ 1.0f, 0.0f, 0.0f }, tangent));
+		}
+
+		/// Removes any component of `reference` along `tangent` (which creeps in through floating-point error) and
+		/// re-normalizes it.
+		static glm::vec3 make_perpendicular(const glm::vec3& reference, const glm::vec3& tangent)
+		{
+			return glm::normalize(reference - tangent * glm::dot(tangent, reference));
+		}
+
+		/// Calls `work(chunk)` for each chunk, spreading them across the pool (if there is one).
+		template<typename Work>
+		void run_chunks(size_t number_of_chunks, const Work& work)
+		{
+			if (pool == nullptr || number_of_chunks == 1)
+			{
+				for (size_t chunk = 0; chunk < number_of_chunks; ++chunk)
+				{
+					work(chunk);
+				}
+
+				return;
+			}
+
+			for (size_t chunk = 0; chunk < number_of_chunks; ++chunk)
+			{
+				pool->submit([&work, chunk] { work(chunk); });
+			}
+			pool->wait();
+		}
+
+		// The (optional) pool that chunks are distributed across
+		utils::ThreadPool* pool;
+
+		// Scratch space, kept around between calls to avoid reallocating
+		std::pmr::vector<glm::mat3> chunk_rotations;
+		std::pmr::vector<glm::vec3> chunk_references;
+		std::pmr::vector<glm::vec2> ring_offsets;
+		std::vector<glm::vec3> adaptive_centers;
+		PolygonalCurve adaptive_curve;
+
+	};
+
+	/// Calls `visit(ring_index, ring)` for each ring of a tube around `curve`, in order (see `TubeBuilder::visit_rings`).
+	/// The builder only needs one rotation and one reference vector per chunk, which fit on the stack for curves with
+	/// up to about 170,000 vertices, so this doesn't allocate unless the curve is larger than that (in which case the
+	/// rest comes from `scratch`).
+	template<typename Visitor>
+	void visit_tube_rings(const PolygonalCurve& curve, std::pmr::memory_resource* scratch, Visitor visit)
+	{
+		std::array<std::byte, 4096> buffer;
+		std::pmr::monotonic_buffer_resource frames{ buffer.data(), buffer.size(), scratch };
+
+		TubeBuilder{ nullptr, &frames }.visit_rings(curve, visit);
+	}
+
+	/// Writes the triangles of an extruded tube around `curve` (see `generate_tube`) to `destination`, which can
+	/// be any output iterator (for example, a pointer into a mapped GPU buffer with room for
+	/// `get_tube_vertex_count(...)` vertices). Only the frames of the current and previous rings are kept around,
+	/// and each ring vertex is rebuilt from its frame when it is needed. Returns the iterator one past the last
+	/// vertex that was written. This doesn't allocate, except for very large curves (see `visit_tube_rings`).
+	template<typename OutputIterator>
+	OutputIterator write_tube(const PolygonalCurve& curve, OutputIterator destination, float radius = 0.5f, size_t number_of_segments = 10, std::pmr::memory_resource* scratch = std::pmr::get_default_resource())
+	{
+		auto ring_prev = TubeRing{};
+
+		visit_tube_rings(curve, scratch, [&](size_t ring_index, const TubeRing& ring) {
+			// Connect the previous ring to this one
+			if (ring_index > 0)
+			{
+				for (size_t local_index = 0; local_index < number_of_segments; local_index++)
+				{
+					// Vertices are laid out in "rings" of `number_of_segments` vertices like
+					// so (for `number_of_segments = 6`):
+					//
+					// 6  7  8  9  ...
+					//
+					// 0  1  2  3  4  5
+					auto next_local_index = (local_index + 1) % number_of_segments;
+
+					const auto a = ring_prev.vertex(local_index, number_of_segments, radius);
+					const auto b = ring.vertex(local_index, number_of_segments, radius); // The next ring
+					const auto c = ring.vertex(next_local_index, number_of_segments, radius); // The next ring
+					const auto d = ring_prev.vertex(next_local_index, number_of_segments, radius);
+
+					// First triangle: 0 -> 6 -> 7
+					*destination++ = a;
+					*destination++ = b;
+					*destination++ = c;
+
+					// Second triangle: 0 -> 7 -> 1
+					*destination++ = a;
+					*destination++ = c;
+					*destination++ = d;
+				}
+			}
+
+			ring_prev = ring;
+		});
+
+		return destination;
+	}
+
+	/// Writes the ring vertices of an indexed tube mesh around `curve` to `destination` (which needs room for
+	/// `get_tube_ring_vertex_count(...)` vertices), one ring after another. Together with the indices from
+	/// `write_tube_indices`, these form exactly the same triangles as `write_tube`, but each vertex is only
+	/// written once (rather than 6 times). Returns the iterator one past the last vertex that was written. Like
+	/// `write_tube`, this doesn't allocate, except for very large curves.
+	///
+	/// To generate the rings in parallel, use a `TubeBuilder` with a thread pool instead.
+	template<typename OutputIterator>
+	OutputIterator write_tube_vertices(const PolygonalCurve& curve, OutputIterator destination, float radius = 0.5f, size_t number_of_segments = 10, std::pmr::memory_resource* scratch = std::pmr::get_default_resource())
+	{
+		visit_tube_rings(curve, scratch, [&](size_t, const TubeRing& ring) {
+			for (size_t local_index = 0; local_index < number_of_segments; local_index++)
+			{
+				*destination++ = ring.vertex(local_index, number_of_segments, radius);
+			}
+		});
+
+		return destination;
+	}
+
+	/// Writes the triangle indices of an indexed tube mesh (see `write_tube_vertices`) to `destination`. The
+	/// topology of the tube only depends on the number of vertices in the curve and `number_of_segments`, so
+	/// these can be generated once and reused for as long as the number of vertices stays the same (i.e. while
+	/// only the positions change). Returns the iterator one past the last index that was written.
+	template<typename OutputIterator>
+	OutputIterator write_tube_indices(size_t number_of_vertices, OutputIterator destination, size_t number_of_segments = 10)
+	{
+		for (size_t ring_index = 0; ring_index < number_of_vertices; ++ring_index)
+		{
+			const auto ring_prev_start = static_cast<uint32_t>(ring_index * number_of_segments);
+			const auto ring_start = static_cast<uint32_t>((ring_index + 1) * number_of_segments);
+
+			for (size_t local_index = 0; local_index < number_of_segments; local_index++)
+			{
+				const auto next_local_index = static_cast<uint32_t>((local_index + 1) % number_of_segments);
+
+				// Same winding as in `write_tube`
+				const auto a = ring_prev_start + static_cast<uint32_t>(local_index);
+				const auto b = ring_start + static_cast<uint32_t>(local_index);
+				const auto c = ring_start + next_local_index;
+				const auto d = ring_prev_start + next_local_index;
+
+				*destination++ = a;
+				*destination++ = b;
+				*destination++ = c;
+
+				*destination++ = a;
+				*destination++ = c;
+				*destination++ = d;
+			}
+		}
+
+		return destination;
+	}
+
+	/// Generates an extruded tube from the specified curve. Within the context of this program, an "extruded tube" is a thick, tubular mesh
+	/// with a circular cross-section of constant radius.
+	inline std::vector<glm::vec3> generate_tube(const PolygonalCurve& curve, float radius = 0.5f, size_t number_of_segments = 10)
+	{
+		std::vector<glm::vec3> triangles;
+		triangles.reserve(get_tube_vertex_count(curve.get_number_of_vertices(), number_of_segments));
+
+		write_tube(curve, std::back_inserter(triangles), radius, number_of_segments);
+
+		return triangles;
+	}
+
+	/// Generates the (unique) vertices of an extruded tube around `curve`, to be drawn with the indices from
+	/// `generate_tube_indices`.
+	inline std::vector<glm::vec3> generate_tube_vertices(const PolygonalCurve& curve, float radius = 0.5f, size_t number_of_segments = 10)
+	{
+		std::vector<glm::vec3> vertices;
+		vertices.reserve(get_tube_ring_vertex_count(curve.get_number_of_vertices(), number_of_segments));
+
+		write_tube_vertices(curve, std::back_inserter(vertices), radius, number_of_segments);
+
+		return vertices;
+	}
+
+	/// Generates the triangle indices of an extruded tube around a curve with `number_of_vertices` vertices.
+	inline std::vector<uint32_t> generate_tube_indices(size_t number_of_vertices, size_t number_of_segments = 10)
+	{
+		std::vector<uint32_t> indices;
+		indices.reserve(get_tube_index_count(number_of_vertices, number_of_segments));
+
+		write_tube_indices(number_of_vertices, std::back_inserter(indices), number_of_segments);
+
+		return indices;
+	}
+
+	/// Same as `generate_tube`, but the triangles are allocated from `resource` (for example, a per-frame 
+	/// `utils::Arena`).
+	inline std::pmr::vector<glm::vec3> generate_tube(const PolygonalCurve& curve, std::pmr::memory_resource* resource, float radius = 0.5f, size_t number_of_segments = 10)
+	{
+		std::pmr::vector<glm::vec3> triangles{ resource };
+		triangles.reserve(get_tube_vertex_count(curve.get_number_of_vertices(), number_of_segments));
+
+		write_tube(curve, std::back_inserter(triangles), radius, number_of_segments, resource);
+
+		return triangles;
+	}
+
+	/// Same as `generate_tube_vertices`, but the vertices are allocated from `resource`.
+	inline std::pmr::vector<glm::vec3> generate_tube_vertices(const PolygonalCurve& curve, std::pmr::memory_resource* resource, float radius = 0.5f, size_t number_of_segments = 10)
+	{
+		std::pmr::vector<glm::vec3> vertices{ resource };
+		vertices.reserve(get_tube_ring_vertex_count(curve.get_number_of_vertices(), number_of_segments));
+
+		write_tube_vertices(curve, std::back_inserter(vertices), radius, number_of_segments, resource);
+
+		return vertices;
+	}
+
+	/// Same as `generate_tube_indices`, but the indices are allocated from `resource`.
+	inline std::pmr::vector<uint32_t> generate_tube_indices(size_t number_of_vertices, std::pmr::memory_resource* resource, size_t number_of_segments = 10)
+	{
+		std::pmr::vector<uint32_t> indices{ resource };
+		indices.reserve(get_tube_index_count(number_of_vertices, number_of_segments));
+
+		write_tube_indices(number_of_vertices, std::back_inserter(indices), number_of_segments);
+
+		return indices;
+	}
+
+}
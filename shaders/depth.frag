@@ -1,6 +1,28 @@
-#version 460
+#version 450
+
+// Must match `ShadowFilter` in main.cpp
+const int SHADOW_FILTER_VARIANCE = 2;
+const int SHADOW_FILTER_EXPONENTIAL = 3;
+
+uniform int u_shadow_filter;
+uniform float u_esm_exponent;
+
+// Only written when the framebuffer has a color attachment (i.e. for variance or exponential shadow maps)
+layout(location = 0) out vec2 o_moments;
 
 void main()
 {             
     // gl_FragDepth = gl_FragCoord.z;
-}
\ No newline at end of file
+
+    // The light uses an orthographic projection, so depth is already linear
+    const float depth = gl_FragCoord.z;
+
+    if (u_shadow_filter == SHADOW_FILTER_EXPONENTIAL)
+    {
+        o_moments = vec2(exp(u_esm_exponent * depth), 0.0);
+    }
+    else
+    {
+        o_moments = vec2(depth, depth * depth);
+    }
+}
@@ -1,13 +1,31 @@
-#version 460
+#version 450
 
 layout(location = 0) in vec3 i_position;
 layout(location = 1) in vec3 i_color;
 layout(location = 2) in vec2 i_texture_coordinates;
+layout(location = 3) in uint i_instance;
 
 uniform mat4 u_light_space_matrix;
 uniform mat4 u_model;
 
+// Whether the model matrix comes from `instances` (indexed by `i_instance`) rather than `u_model`
+uniform bool u_instanced;
+
+// Must match `GalleryInstance` in main.cpp
+struct Instance
+{
+    mat4 model;
+    vec4 size_of_bounds;
+};
+
+layout(std430, binding = 0) readonly buffer Instances
+{
+    Instance instances[];
+};
+
 void main()
 {
-    gl_Position = u_light_space_matrix * u_model * vec4(i_position, 1.0);
+    const mat4 model = u_instanced ? instances[i_instance].model : u_model;
+
+    gl_Position = u_light_space_matrix * model * vec4(i_position, 1.0);
 }
\ No newline at end of file
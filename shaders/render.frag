@@ -1,7 +1,26 @@
-#version 460
+#version 450
+
+// Must match `ShadowFilter` in main.cpp
+const int SHADOW_FILTER_POISSON = 0;
+const int SHADOW_FILTER_HARDWARE = 1;
+const int SHADOW_FILTER_VARIANCE = 2;
+const int SHADOW_FILTER_EXPONENTIAL = 3;
 
 uniform bool u_display_shadows = true;
-layout(location = 0) uniform sampler2D u_depth_map;
+uniform int u_shadow_filter = SHADOW_FILTER_POISSON;
+
+// The radius of the Poisson disk (in texels)
+uniform float u_filter_radius = 20.0;
+
+// The exponent used by exponential shadow maps (the same one that was used to write the moment map)
+uniform float u_esm_exponent = 80.0;
+
+// The light's depth map, sampled with depth comparisons (and bilinear filtering) enabled
+layout(binding = 0) uniform sampler2DShadow u_depth_map;
+
+// The light's (blurred) moments: depth and depth squared for variance shadow maps, or exp(c * depth) for
+// exponential shadow maps
+layout(binding = 1) uniform sampler2D u_moment_map;
 
 layout(location = 0) out vec4 o_color;
 
@@ -11,6 +30,75 @@ in VS_OUT
     vec4 light_space_position;
 } fs_in;
 
+const int number_of_poisson_taps = 16;
+const vec2 poisson_disk[number_of_poisson_taps] = vec2[](
+	vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+	vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+	vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+	vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+	vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+	vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+	vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+	vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+// Returns the fraction of the light that is blocked at `coordinates` (in the light's 0..1 texture space)
+float get_shadow(vec3 coordinates)
+{
+	const float bias = 0.0075;
+	const float current = coordinates.z - bias;
+
+	// Everything outside of the light's frustum is lit
+	if (any(lessThan(coordinates.xy, vec2(0.0))) || any(greaterThan(coordinates.xy, vec2(1.0))))
+	{
+		return 0.0;
+	}
+
+	if (u_shadow_filter == SHADOW_FILTER_HARDWARE)
+	{
+		// A single tap: the hardware compares (and bilinearly filters) the 4 nearest texels
+		return 1.0 - texture(u_depth_map, vec3(coordinates.xy, current));
+	}
+	else if (u_shadow_filter == SHADOW_FILTER_VARIANCE)
+	{
+		const vec2 moments = texture(u_moment_map, coordinates.xy).rg;
+		if (current <= moments.x)
+		{
+			return 0.0;
+		}
+
+		// Chebyshev's upper bound on the fraction of the light that reaches this fragment
+		const float variance = max(moments.y - moments.x * moments.x, 0.00002);
+		const float delta = current - moments.x;
+		float lit = variance / (variance + delta * delta);
+
+		// Cut off the tail of the bound, which reduces light bleeding where occluders overlap
+		const float light_bleeding_reduction = 0.3;
+		lit = clamp((lit - light_bleeding_reduction) / (1.0 - light_bleeding_reduction), 0.0, 1.0);
+
+		return 1.0 - lit;
+	}
+	else if (u_shadow_filter == SHADOW_FILTER_EXPONENTIAL)
+	{
+		const float occluder = texture(u_moment_map, coordinates.xy).r;
+		return 1.0 - clamp(occluder * exp(-u_esm_exponent * current), 0.0, 1.0);
+	}
+
+	// Poisson disk PCF: rotate the disk per pixel, which trades the banding of a small, fixed kernel for noise
+	const vec2 texel_size = 1.0 / textureSize(u_depth_map, 0);
+	const float angle = 6.28318530 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+	const mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+
+	float lit = 0.0;
+	for (int i = 0; i < number_of_poisson_taps; ++i)
+	{
+		const vec2 offset = rotation * poisson_disk[i] * u_filter_radius * texel_size;
+		lit += texture(u_depth_map, vec3(coordinates.xy + offset, current));
+	}
+
+	return 1.0 - lit / float(number_of_poisson_taps);
+}
+
 void main() 
 {	
 	float shadow = 0.0;
@@ -22,24 +110,7 @@ void main()
 		// Transform NDC coordinates from -1..1 to 0..1
 		projection_space_coordinates = projection_space_coordinates * 0.5 + 0.5;
 
-		// Grab the current fragment depth
-		float current = projection_space_coordinates.z;
-
-		// Filtering
-		const float bias = 0.0075;
-		const vec2 texel_size = 1.0 / textureSize(u_depth_map, 0);
-		const int kernel_steps = 20;
-		for(int x = -kernel_steps; x <= kernel_steps; ++x)
-		{
-		    for(int y = -kernel_steps; y <= kernel_steps; ++y)
-		    {
-		        float percentage_close = texture(u_depth_map, projection_space_coordinates.xy + vec2(x, y) * texel_size).r; 
-		        shadow += current - bias > percentage_close ? 1.0 : 0.0;        
-		    }    
-		}
-
-		// Normalize based on number of steps
-		shadow /= pow(kernel_steps * 2.0 + 1.0, 2.0);
+		shadow = get_shadow(projection_space_coordinates);
 
 		// Prevent shadows from being 100% black
 		shadow = min(shadow, 0.6);
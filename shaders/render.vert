@@ -1,4 +1,4 @@
-#version 460
+#version 450
 
 uniform mat4 u_light_space_matrix;
 uniform float u_time;
@@ -10,9 +10,25 @@ uniform mat4 u_model;
 // The size (xyz) of the bounding box of this knot
 uniform vec3 u_size_of_bounds;
 
+// Whether the model matrix and bounds come from `instances` (indexed by `i_instance`) rather than the uniforms above
+uniform bool u_instanced;
+
+// Must match `GalleryInstance` in main.cpp
+struct Instance
+{
+    mat4 model;
+    vec4 size_of_bounds;
+};
+
+layout(std430, binding = 0) readonly buffer Instances
+{
+    Instance instances[];
+};
+
 layout(location = 0) in vec3 i_position;
 layout(location = 1) in vec3 i_color;
 layout(location = 2) in vec2 i_texture_coordinates;
+layout(location = 3) in uint i_instance;
 
 out VS_OUT
 {
@@ -23,10 +39,13 @@ out VS_OUT
 
 void main() 
 {
-    gl_Position = u_projection * u_view * u_model * vec4(i_position, 1.0);
+    const mat4 model = u_instanced ? instances[i_instance].model : u_model;
+    const vec3 size_of_bounds = u_instanced ? instances[i_instance].size_of_bounds.xyz : u_size_of_bounds;
+
+    gl_Position = u_projection * u_view * model * vec4(i_position, 1.0);
 
     // Set the color based on the (normalized) coordinates of this vertex
-    vs_out.color = (i_position / u_size_of_bounds) * 0.5 + 0.5;
+    vs_out.color = (i_position / size_of_bounds) * 0.5 + 0.5;
     
-    vs_out.light_space_position = u_light_space_matrix * u_model * vec4(i_position, 1.0);
+    vs_out.light_space_position = u_light_space_matrix * model * vec4(i_position, 1.0);
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
-#version 460
+#version 450
 
 uniform	int u_number_of_vertices;
 
@@ -0,0 +1,78 @@
+// Replacements for the global allocation functions, which report every allocation to `utils::AllocationTracker`
+// (this file is only compiled when the `GRIDKNOT_TRACK_ALLOCATIONS` option is enabled)
+//
+// The basic and over-aligned forms are replaced: the array and `nothrow` forms call these by default. The aligned
+// ones matter even though nothing here asks for over-aligned types, since libstdc++'s `new_delete_resource` (the
+// default `std::pmr` resource) always allocates through them.
+
+#include <cstdlib>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+#include <new>
+
+#include "allocation_tracker.h"
+
+void* operator new(std::size_t size)
+{
+    utils::AllocationTracker::record(size);
+
+    if (void* pointer = std::malloc(size == 0 ? 1 : size))
+    {
+        return pointer;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+// MSVC has no `aligned_alloc`, and memory from `_aligned_malloc` has to be released with `_aligned_free`
+static void* allocate_aligned(std::size_t size, std::size_t alignment)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    // `aligned_alloc` needs the size to be a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+static void free_aligned(void* pointer)
+{
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    utils::AllocationTracker::record(size);
+
+    if (void* pointer = allocate_aligned(size == 0 ? 1 : size, static_cast<std::size_t>(alignment)))
+    {
+        return pointer;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    free_aligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+    free_aligned(pointer);
+}
@@ -0,0 +1,409 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "allocation_tracker.h"
+#include "diagram.h"
+#include "families.h"
+#include "invariants.h"
+#include "knot.h"
+#include "mesh_export.h"
+#include "thread_pool.h"
+#include "tube.h"
+
+// Where results are written (see `gridknot.cpp`)
+std::ostream output{ std::cout.rdbuf() };
+
+struct Options
+{
+    std::vector<std::string> families = { "torus", "twist", "random", "sum", "stabilized" };
+    size_t min_size = 16;
+    size_t max_size = 256;
+    size_t steps = 10;
+    uint64_t seed = 0;
+    bool skip_invariants = false;
+    bool check_allocations = false;
+    size_t warmup_steps = 100;
+    std::string output;
+    bool verbose = false;
+};
+
+// The time (in milliseconds) that each stage took for a single diagram
+struct Measurement
+{
+    std::string family;
+    size_t grid_number = 0;
+    size_t number_of_vertices = 0;
+    float generate = 0.0f;
+    float invariants = 0.0f;
+    float curve = 0.0f;
+    float relax = 0.0f;
+    float mesh = 0.0f;
+
+    // Heap allocations per relaxation step, and the number of allocations in the steady state and while writing
+    // the tube mesh (see `--check-allocations`)
+    double relax_allocations = 0.0;
+    double relax_bytes = 0.0;
+    uint64_t steady_state_allocations = 0;
+    uint64_t tube_allocations = 0;
+};
+
+// An output iterator that throws away whatever is written to it and only counts how many values there were, so
+// that writing a mesh to it doesn't allocate anything by itself. It can also be offset like a random access
+// iterator (every position is the same), which is all that `TubeBuilder` needs to write rings from several threads.
+struct CountingIterator
+{
+    std::atomic<size_t>* count;
+
+    CountingIterator& operator*() { return *this; }
+    CountingIterator& operator++() { return *this; }
+    CountingIterator operator++(int) { return *this; }
+    CountingIterator operator+(size_t) const { return *this; }
+
+    template<typename T>
+    CountingIterator& operator=(const T&)
+    {
+        count->fetch_add(1, std::memory_order_relaxed);
+        return *this;
+    }
+};
+
+[[noreturn]] void usage()
+{
+    std::cerr << "Usage: gridknot_benchmark [options]\n"
+              << "\n"
+              << "Generates diagrams from each family, with grid numbers that double from the minimum size up to\n"
+              << "the maximum size, and times each stage of the pipeline on them. Results are written as .csv.\n"
+              << "\n"
+              << "Options:\n"
+              << "  --families <list>  Comma-separated families (default: torus,twist,random,sum,stabilized)\n"
+              << "  --min-size <n>     Smallest grid number (default: 16)\n"
+              << "  --max-size <n>     Largest grid number (default: 256)\n"
+              << "  --steps <n>        Relaxation steps per diagram (default: 10)\n"
+              << "  --seed <n>         Seed for the random families (default: 0)\n"
+              << "  --skip-invariants  Don't time the invariants, which are O(n^3) in the grid number\n"
+              << "  --check-allocations\n"
+              << "                     After the timed steps and a warm-up, relax each knot for the same number of steps\n"
+              << "                     again and fail if any of them allocate, or if writing their tube meshes does\n"
+              << "                     (requires GRIDKNOT_TRACK_ALLOCATIONS)\n"
+              << "  --warmup-steps <n> Steps between the timed steps and the allocation check (default: 100), during\n"
+              << "                     which the knot tightens and its neighbor lists grow to their working size\n"
+              << "  -o, --output <path>\n"
+              << "  --verbose          Show the library's progress messages" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+Options parse_options(int argc, char* argv[])
+{
+    Options options;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+
+            const auto value = [&] {
+                if (i + 1 >= argc)
+                {
+                    usage();
+                }
+                return std::string{ argv[++i] };
+            };
+
+            if (argument == "--families")
+            {
+                options.families.clear();
+
+                std::istringstream stream{ value() };
+                std::string family;
+                while (std::getline(stream, family, ','))
+                {
+                    options.families.push_back(family);
+                }
+            }
+            else if (argument == "--min-size") options.min_size = std::stoul(value());
+            else if (argument == "--max-size") options.max_size = std::stoul(value());
+            else if (argument == "--steps") options.steps = std::stoul(value());
+            else if (argument == "--seed") options.seed = std::stoull(value());
+            else if (argument == "--skip-invariants") options.skip_invariants = true;
+            else if (argument == "--check-allocations") options.check_allocations = true;
+            else if (argument == "--warmup-steps") options.warmup_steps = std::stoul(value());
+            else if (argument == "-o" || argument == "--output") options.output = value();
+            else if (argument == "--verbose") options.verbose = true;
+            else usage();
+        }
+    }
+    catch (const std::exception&)
+    {
+        usage();
+    }
+
+    if (options.min_size < 8 || options.max_size < options.min_size)
+    {
+        usage();
+    }
+
+    return options;
+}
+
+/**
+ * Returns a member of `family` whose grid number is (roughly) `size`.
+ */
+knot::Diagram generate(const std::string& family, size_t size, uint64_t seed)
+{
+    if (family == "torus")
+    {
+        // T(k, k + 1), which is always a knot
+        return knot::families::torus((size - 1) / 2, (size - 1) / 2 + 1);
+    }
+    else if (family == "twist")
+    {
+        return knot::families::twist(size - 4);
+    }
+    else if (family == "random")
+    {
+        return knot::families::random(size, seed);
+    }
+    else if (family == "sum")
+    {
+        // A twist knot and a torus knot, each with about half of the rows
+        const auto half = size / 2;
+        return knot::families::connected_sum(knot::families::twist(half - 4), knot::families::torus(half / 2, size - half + 1 - half / 2));
+    }
+    else if (family == "stabilized")
+    {
+        // The trefoil, stabilized until it fills the grid
+        return knot::families::stabilize(knot::families::twist(1), size - 5, seed);
+    }
+
+    throw std::invalid_argument("Unknown family: " + family);
+}
+
+/**
+ * Returns the number of milliseconds that have passed since `start`, and resets it.
+ */
+float lap(std::chrono::high_resolution_clock::time_point& start)
+{
+    const auto now = std::chrono::high_resolution_clock::now();
+    const auto elapsed = std::chrono::duration<float, std::milli>(now - start).count();
+    start = now;
+
+    return elapsed;
+}
+
+Measurement measure(const std::string& family, size_t size, const Options& options)
+{
+    Measurement measurement;
+    measurement.family = family;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const auto diagram = generate(family, size, options.seed);
+    measurement.grid_number = diagram.get_size();
+    measurement.generate = lap(start);
+
+    if (!options.skip_invariants)
+    {
+        knot::get_invariants(diagram);
+        measurement.invariants = lap(start);
+    }
+
+    const auto curve = diagram.generate_curve();
+    measurement.number_of_vertices = curve.get_number_of_vertices();
+    measurement.curve = lap(start);
+
+    auto knot = knot::Knot{ curve };
+    {
+        utils::AllocationScope scope{ "Relax" };
+        for (size_t step = 0; step < options.steps; ++step)
+        {
+            knot.relax();
+        }
+
+        const auto counts = scope.get_counts();
+        measurement.relax_allocations = static_cast<double>(counts.allocations) / std::max(options.steps, size_t{ 1 });
+        measurement.relax_bytes = static_cast<double>(counts.bytes) / std::max(options.steps, size_t{ 1 });
+    }
+    measurement.relax = lap(start);
+
+    // Once the knot has (mostly) tightened, every buffer that the simulation reuses has grown to its working size
+    if (options.check_allocations)
+    {
+        for (size_t step = 0; step < options.warmup_steps; ++step)
+        {
+            knot.relax();
+        }
+
+        const auto before = utils::AllocationTracker::get_violations();
+        {
+            utils::NoAllocationScope scope;
+            for (size_t step = 0; step < options.steps; ++step)
+            {
+                knot.relax();
+            }
+        }
+        measurement.steady_state_allocations = utils::AllocationTracker::get_violations() - before;
+
+        // The tube writers only keep a few frames around, so they shouldn't need the heap either (the first call
+        // builds the rope's arc length table, which is then reused)
+        const auto& rope = knot.get_rope();
+        std::atomic<size_t> written{ 0 };
+        geom::write_tube(rope, CountingIterator{ &written });
+
+        const auto before_tube = utils::AllocationTracker::get_violations();
+        {
+            utils::NoAllocationScope scope;
+            geom::write_tube(rope, CountingIterator{ &written });
+            geom::write_tube_vertices(rope, CountingIterator{ &written });
+        }
+        measurement.tube_allocations = utils::AllocationTracker::get_violations() - before_tube;
+
+        const auto expected = 2 * geom::get_tube_vertex_count(rope.get_number_of_vertices()) + geom::get_tube_ring_vertex_count(rope.get_number_of_vertices());
+        if (written != expected)
+        {
+            throw std::runtime_error("The tube writers wrote " + std::to_string(written) + " vertices instead of " + std::to_string(expected));
+        }
+
+        // Every frame, the GUI writes the tube (at its current level of detail) with a pooled builder, along with the
+        // stuck flags. Check that path as well, for as many frames as there are steps, on a curve that is long enough
+        // to be split into several chunks. The pool's workers don't count towards this thread's `NoAllocationScope`,
+        // so compare the totals instead.
+        utils::ThreadPool pool{ 4 };
+        auto tube_builder = geom::TubeBuilder{ &pool };
+        const auto dense = geom::PolygonalCurve{ rope.sample_uniform(std::max(rope.get_number_of_vertices(), 3 * geom::TubeBuilder::chunk_size)) };
+
+        std::atomic<size_t> frame_written{ 0 };
+        const auto write_frame = [&] {
+            for (const auto& detail : geom::tube_details)
+            {
+                tube_builder.write_adaptive_vertices(dense, CountingIterator{ &frame_written }, detail);
+            }
+            knot.write_stuck(CountingIterator{ &frame_written });
+        };
+        write_frame();
+
+        frame_written = 0;
+        const auto before_frame = utils::AllocationTracker::get_total_counts().allocations;
+        {
+            utils::NoAllocationScope scope;
+            for (size_t step = 0; step < options.steps; ++step)
+            {
+                write_frame();
+            }
+        }
+        measurement.tube_allocations += utils::AllocationTracker::get_total_counts().allocations - before_frame;
+
+        size_t expected_frame = knot.get_rope().get_number_of_vertices();
+        for (const auto& detail : geom::tube_details)
+        {
+            const auto number_of_rings = geom::get_tube_ring_count(dense.get_number_of_vertices(), detail);
+            expected_frame += geom::get_tube_ring_vertex_count(number_of_rings, detail.number_of_segments);
+        }
+        expected_frame *= options.steps;
+        if (frame_written != expected_frame)
+        {
+            throw std::runtime_error("The pooled tube builder wrote " + std::to_string(frame_written) + " values instead of " + std::to_string(expected_frame));
+        }
+        lap(start);
+    }
+
+    std::ostringstream mesh;
+    geom::MeshExporter::write_tube(mesh, knot.get_rope(), geom::MeshFormat::PLY);
+    measurement.mesh = lap(start);
+
+    return measurement;
+}
+
+int main(int argc, char* argv[])
+{
+    const auto options = parse_options(argc, argv);
+    if (!options.verbose)
+    {
+        std::cout.rdbuf(nullptr);
+    }
+
+    std::ofstream file;
+    if (!options.output.empty())
+    {
+        file.open(options.output, std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Error: unable to open file for writing: " << options.output << std::endl;
+            return EXIT_FAILURE;
+        }
+        output.rdbuf(file.rdbuf());
+    }
+
+    if (options.check_allocations && !utils::AllocationTracker::is_enabled())
+    {
+        std::cerr << "Error: --check-allocations requires a build with GRIDKNOT_TRACK_ALLOCATIONS" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    output << "family,grid_number,vertices,generate_ms,invariants_ms,curve_ms,relax_ms,mesh_ms,relax_allocations,relax_bytes" << std::endl;
+
+    // The diagrams whose steady-state simulation allocated
+    std::vector<std::string> failures;
+
+    try
+    {
+        for (const auto& family : options.families)
+        {
+            for (auto size = options.min_size; size <= options.max_size; size *= 2)
+            {
+                const auto m = measure(family, size, options);
+
+                output << m.family << "," << m.grid_number << "," << m.number_of_vertices << ","
+                       << m.generate << "," << m.invariants << "," << m.curve << "," << m.relax << "," << m.mesh << ","
+                       << m.relax_allocations << "," << m.relax_bytes << std::endl;
+
+                if (m.steady_state_allocations > 0)
+                {
+                    failures.push_back(family + " (" + std::to_string(m.grid_number) + " x " + std::to_string(m.grid_number) + "): " +
+                                       std::to_string(m.steady_state_allocations) + " allocation(s)");
+                }
+                if (m.tube_allocations > 0)
+                {
+                    failures.push_back(family + " (" + std::to_string(m.grid_number) + " x " + std::to_string(m.grid_number) + "): " +
+                                       std::to_string(m.tube_allocations) + " allocation(s) while writing the tube");
+                }
+
+                // Show progress when the results aren't already going to the terminal
+                if (!options.output.empty())
+                {
+                    std::cerr << family << " (" << m.grid_number << " x " << m.grid_number << "): generate " << m.generate
+                              << " ms, invariants " << m.invariants << " ms, curve " << m.curve << " ms, relax " << m.relax
+                              << " ms, mesh " << m.mesh << " ms" << std::endl;
+                }
+            }
+        }
+    }
+    catch (const knot::CromwellException& e)
+    {
+        std::cerr << "Error: " << e.get_message() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!failures.empty())
+    {
+        std::cerr << "The steady-state simulation or the tube writers allocated for:" << std::endl;
+        for (const auto& failure : failures)
+        {
+            std::cerr << "  " << failure << std::endl;
+        }
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
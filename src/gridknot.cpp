@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "allocation_tracker.h"
+#include "batch.h"
+#include "diagram.h"
+#include "families.h"
+#include "invariants.h"
+#include "knot.h"
+#include "mesh_export.h"
+
+// Where results are written: the core library reports its progress on `std::cout`, which is silenced (unless
+// `--verbose` is passed) so that it doesn't get mixed in with them
+std::ostream output{ std::cout.rdbuf() };
+
+// The options that are shared by all of the subcommands (each one only looks at the ones that it needs)
+struct Options
+{
+    std::vector<std::string> arguments;
+    std::string output;
+    size_t iterations = 1000;
+    size_t threads = 0;
+    std::string checkpoints;
+    size_t checkpoint_interval = 1000;
+    float radius = 0.5f;
+    size_t segments = 10;
+    uint64_t seed = 0;
+    bool links = false;
+    bool allocations = false;
+    bool verbose = false;
+};
+
+[[noreturn]] void usage()
+{
+    std::cerr << "Usage: gridknot <command> [options]\n"
+              << "\n"
+              << "Commands:\n"
+              << "  load <diagram.csv>                    Validate a grid diagram and print it\n"
+              << "  apply-moves <diagram.csv> <move>...   Apply Cromwell moves and print the resulting diagram\n"
+              << "  generate-curve <diagram.csv>          Print the (unrelaxed) polygonal curve of a diagram\n"
+              << "  relax <diagram.csv>...                Relax one or more knots and print their curves (.obj)\n"
+              << "  mesh <diagram.csv>                    Relax a knot and print a tube mesh around it\n"
+              << "  invariants <diagram.csv>...           Print the invariants of one or more diagrams\n"
+              << "  generate <family> <argument>...       Print a generated grid diagram (see below)\n"
+              << "\n"
+              << "Families:\n"
+              << "  torus <p> <q>                         The torus knot (or link) T(p, q)\n"
+              << "  twist <n>                             The twist knot with n half-twists\n"
+              << "  random <size>                         A random knot (or link, with --links)\n"
+              << "  sum <diagram.csv>...                  The connected sum of two or more diagrams\n"
+              << "  stabilize <diagram.csv> <count>       A diagram after `count` random stabilizations\n"
+              << "\n"
+              << "Moves:\n"
+              << "  translate:<up|down|left|right>\n"
+              << "  commute:<row|col>:<index>\n"
+              << "  stabilize:<nw|sw|ne|se>:<row>:<col>\n"
+              << "  destabilize:<row>:<col>\n"
+              << "\n"
+              << "Options:\n"
+              << "  -o, --output <path>        Write to a file instead of stdout (.obj, .ply or .stl for curves / meshes)\n"
+              << "  --iterations <n>           Number of relaxation steps (default: 1000)\n"
+              << "  --threads <n>              Number of worker threads for `relax` (default: one per core)\n"
+              << "  --checkpoints <directory>  Checkpoint (and resume) long relaxations in this directory\n"
+              << "  --checkpoint-interval <n>  Relaxation steps between checkpoints (default: 1000)\n"
+              << "  --radius <r>               Tube radius for `mesh` (default: 0.5)\n"
+              << "  --segments <n>             Tube segments for `mesh` (default: 10)\n"
+              << "  --seed <n>                 Seed for random families (default: 0)\n"
+              << "  --links                    Let `random` generate links with more than one component\n"
+              << "  --allocations              Report heap allocations (per relaxation step and per move) when done\n"
+              << "  --verbose                  Show the library's progress messages" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Parse everything after the subcommand: options may appear anywhere, and everything else is an argument.
+ */
+Options parse_options(int argc, char* argv[])
+{
+    Options options;
+
+    try
+    {
+        for (int i = 2; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+
+            // Returns the value that follows the current option
+            const auto value = [&] {
+                if (i + 1 >= argc)
+                {
+                    usage();
+                }
+                return std::string{ argv[++i] };
+            };
+
+            if (argument == "-o" || argument == "--output") options.output = value();
+            else if (argument == "--iterations") options.iterations = std::stoul(value());
+            else if (argument == "--threads") options.threads = std::stoul(value());
+            else if (argument == "--checkpoints") options.checkpoints = value();
+            else if (argument == "--checkpoint-interval") options.checkpoint_interval = std::stoul(value());
+            else if (argument == "--radius") options.radius = std::stof(value());
+            else if (argument == "--segments") options.segments = std::stoul(value());
+            else if (argument == "--seed") options.seed = std::stoull(value());
+            else if (argument == "--links") options.links = true;
+            else if (argument == "--allocations") options.allocations = true;
+            else if (argument == "--verbose") options.verbose = true;
+            else if (argument.size() > 1 && argument[0] == '-') usage();
+            else options.arguments.push_back(argument);
+        }
+    }
+    catch (const std::exception&)
+    {
+        usage();
+    }
+
+    return options;
+}
+
+/**
+ * Split `text` on every occurrence of `delimiter`.
+ */
+std::vector<std::string> split(const std::string& text, char delimiter)
+{
+    std::vector<std::string> parts;
+    std::istringstream stream{ text };
+    std::string part;
+    while (std::getline(stream, part, delimiter))
+    {
+        parts.push_back(part);
+    }
+
+    return parts;
+}
+
+/**
+ * Pick a mesh format based on the extension of `path` (text .obj files are written to stdout).
+ */
+geom::MeshFormat get_mesh_format(const std::string& path)
+{
+    const auto extension = std::filesystem::path{ path }.extension().string();
+    if (path.empty() || extension == ".obj") return geom::MeshFormat::OBJ;
+    if (extension == ".ply") return geom::MeshFormat::PLY;
+    if (extension == ".stl") return geom::MeshFormat::STL;
+
+    throw std::invalid_argument("Unknown mesh format (expected .obj, .ply, or .stl): " + path);
+}
+
+/**
+ * Call `write` with the output file (if one was given) or the output stream.
+ */
+template<typename Write>
+void write_output(const Options& options, Write write)
+{
+    if (options.output.empty())
+    {
+        write(output);
+        output.flush();
+        return;
+    }
+
+    std::ofstream file{ options.output, std::ios::binary | std::ios::trunc };
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Unable to open file for writing: " + options.output);
+    }
+
+    write(file);
+
+    file.flush();
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write file: " + options.output);
+    }
+}
+
+/**
+ * Apply a single Cromwell move, written as `<move>:<argument>:...` (see `usage`).
+ */
+void apply_move(knot::Diagram& diagram, const std::string& move)
+{
+    const auto parts = split(move, ':');
+    const auto invalid = std::invalid_argument("Invalid move: " + move);
+    const auto index = [&](size_t part) {
+        if (part >= parts.size())
+        {
+            throw invalid;
+        }
+        return static_cast<size_t>(std::stoul(parts[part]));
+    };
+
+    if (parts.empty())
+    {
+        throw invalid;
+    }
+    else if (parts[0] == "translate" && parts.size() == 2)
+    {
+        const std::vector<std::string> directions = { "up", "down", "left", "right" };
+        const auto direction = std::find(directions.begin(), directions.end(), parts[1]) - directions.begin();
+        if (direction == static_cast<ptrdiff_t>(directions.size()))
+        {
+            throw invalid;
+        }
+        diagram.apply_translation(static_cast<knot::Direction>(direction));
+    }
+    else if (parts[0] == "commute" && parts.size() == 3 && (parts[1] == "row" || parts[1] == "col"))
+    {
+        diagram.apply_commutation(parts[1] == "row" ? knot::Axis::ROW : knot::Axis::COL, index(2));
+    }
+    else if (parts[0] == "stabilize" && parts.size() == 4)
+    {
+        const std::vector<std::string> cardinals = { "nw", "sw", "ne", "se" };
+        const auto cardinal = std::find(cardinals.begin(), cardinals.end(), parts[1]) - cardinals.begin();
+        const auto i = index(2);
+        const auto j = index(3);
+        if (cardinal == static_cast<ptrdiff_t>(cardinals.size()) || i >= diagram.get_size() || j >= diagram.get_size())
+        {
+            throw invalid;
+        }
+        diagram.apply_stabilization(static_cast<knot::Cardinal>(cardinal), i, j);
+    }
+    else if (parts[0] == "destabilize" && parts.size() == 3)
+    {
+        const auto i = index(1);
+        const auto j = index(2);
+        if (i + 1 >= diagram.get_size() || j + 1 >= diagram.get_size())
+        {
+            throw invalid;
+        }
+        diagram.apply_destabilization(i, j);
+    }
+    else
+    {
+        throw invalid;
+    }
+}
+
+/**
+ * Build the knot of `diagram` and relax it for `options.iterations` steps.
+ */
+knot::Knot relax(const knot::Diagram& diagram, const Options& options)
+{
+    auto knot = knot::Knot{ diagram.generate_curve() };
+    while (knot.get_number_of_steps() < options.iterations)
+    {
+        utils::AllocationScope scope{ "Relax" };
+        knot.relax();
+    }
+
+    return knot;
+}
+
+int run_load(const Options& options)
+{
+    if (options.arguments.size() != 1) usage();
+
+    const auto diagram = knot::Diagram{ options.arguments[0] };
+    std::cerr << "Grid diagram is " << diagram.get_size() << " x " << diagram.get_size() << std::endl;
+    write_output(options, [&](std::ostream& stream) { diagram.write_csv(stream); });
+
+    return EXIT_SUCCESS;
+}
+
+int run_apply_moves(const Options& options)
+{
+    if (options.arguments.empty()) usage();
+
+    auto diagram = knot::Diagram{ options.arguments[0] };
+    for (size_t i = 1; i < options.arguments.size(); ++i)
+    {
+        utils::AllocationScope scope{ "Move" };
+        apply_move(diagram, options.arguments[i]);
+    }
+    write_output(options, [&](std::ostream& stream) { diagram.write_csv(stream); });
+
+    return EXIT_SUCCESS;
+}
+
+int run_generate_curve(const Options& options)
+{
+    if (options.arguments.size() != 1) usage();
+
+    const auto diagram = knot::Diagram{ options.arguments[0] };
+    const auto curve = diagram.generate_curve();
+    write_output(options, [&](std::ostream& stream) { geom::MeshExporter::write_curve(stream, curve, get_mesh_format(options.output)); });
+
+    return EXIT_SUCCESS;
+}
+
+int run_relax(const Options& options)
+{
+    if (options.arguments.empty()) usage();
+    if (get_mesh_format(options.output) != geom::MeshFormat::OBJ)
+    {
+        throw std::invalid_argument("Relaxed knots can only be written to .obj files");
+    }
+
+    knot::BatchSettings settings;
+    settings.iterations = options.iterations;
+    settings.number_of_threads = options.threads;
+    settings.checkpoint_directory = options.checkpoints;
+    settings.checkpoint_interval = options.checkpoint_interval;
+    if (!settings.checkpoint_directory.empty())
+    {
+        std::filesystem::create_directories(settings.checkpoint_directory);
+    }
+
+    const auto jobs = knot::load_batch_jobs(options.arguments, options.threads);
+    size_t relaxed = 0;
+    write_output(options, [&](std::ostream& stream) {
+        auto writer = knot::BatchWriter{ stream };
+        relaxed = knot::relax_batch(jobs, settings, writer);
+    });
+    std::cerr << "Relaxed " << relaxed << " knot(s) for " << options.iterations << " iteration(s)" << std::endl;
+
+    return relaxed == options.arguments.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int run_mesh(const Options& options)
+{
+    if (options.arguments.size() != 1) usage();
+
+    const auto format = get_mesh_format(options.output);
+    const auto knot = relax(knot::Diagram{ options.arguments[0] }, options);
+    write_output(options, [&](std::ostream& stream) { geom::MeshExporter::write_tube(stream, knot.get_rope(), format, options.radius, options.segments); });
+
+    return EXIT_SUCCESS;
+}
+
+int run_invariants(const Options& options)
+{
+    if (options.arguments.empty()) usage();
+
+    write_output(options, [&](std::ostream& stream) {
+        for (const auto& path : options.arguments)
+        {
+            const auto invariants = knot::get_invariants(knot::Diagram{ path });
+
+            stream << path << "\n"
+                   << "  grid number: " << invariants.grid_number << "\n"
+                   << "  components: " << invariants.number_of_components << "\n"
+                   << "  crossings: " << invariants.number_of_crossings << "\n"
+                   << "  writhe: " << invariants.writhe << "\n"
+                   << "  linking number: " << invariants.linking_number << "\n"
+                   << "  determinant: " << (invariants.determinant < 0 ? "too large" : std::to_string(invariants.determinant)) << "\n";
+        }
+    });
+
+    return EXIT_SUCCESS;
+}
+
+int run_generate(const Options& options)
+{
+    const auto& arguments = options.arguments;
+    if (arguments.empty()) usage();
+
+    // Returns the argument at `index` as a number
+    const auto number = [&](size_t index) -> size_t {
+        if (index >= arguments.size())
+        {
+            usage();
+        }
+        return std::stoul(arguments[index]);
+    };
+
+    const auto& family = arguments[0];
+    const auto diagram = [&] {
+        if (family == "torus" && arguments.size() == 3)
+        {
+            return knot::families::torus(number(1), number(2));
+        }
+        else if (family == "twist" && arguments.size() == 2)
+        {
+            return knot::families::twist(number(1));
+        }
+        else if (family == "random" && arguments.size() == 2)
+        {
+            return knot::families::random(number(1), options.seed, !options.links);
+        }
+        else if (family == "sum" && arguments.size() >= 3)
+        {
+            auto sum = knot::Diagram{ arguments[1] };
+            for (size_t i = 2; i < arguments.size(); ++i)
+            {
+                sum = knot::families::connected_sum(sum, knot::Diagram{ arguments[i] });
+            }
+            return sum;
+        }
+        else if (family == "stabilize" && arguments.size() == 3)
+        {
+            return knot::families::stabilize(knot::Diagram{ arguments[1] }, number(2), options.seed);
+        }
+
+        usage();
+    }();
+
+    std::cerr << "Grid diagram is " << diagram.get_size() << " x " << diagram.get_size() << std::endl;
+    write_output(options, [&](std::ostream& stream) { diagram.write_csv(stream); });
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        usage();
+    }
+
+    const std::string command = argv[1];
+    const auto options = parse_options(argc, argv);
+    if (!options.verbose)
+    {
+        std::cout.rdbuf(nullptr);
+    }
+
+    // Returns the result of a command, after reporting its allocations (if requested)
+    const auto finish = [&](int result) {
+        if (options.allocations)
+        {
+            utils::write_allocation_report(std::cerr);
+        }
+        return result;
+    };
+
+    try
+    {
+        if (command == "load") return finish(run_load(options));
+        if (command == "apply-moves") return finish(run_apply_moves(options));
+        if (command == "generate-curve") return finish(run_generate_curve(options));
+        if (command == "relax") return finish(run_relax(options));
+        if (command == "mesh") return finish(run_mesh(options));
+        if (command == "invariants") return finish(run_invariants(options));
+        if (command == "generate") return finish(run_generate(options));
+    }
+    catch (const knot::CromwellException& e)
+    {
+        std::cerr << "Error: " << e.get_message() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    usage();
+}
@@ -1,6 +1,14 @@
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <sstream>
 
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
@@ -10,11 +18,22 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include "allocation_tracker.h"
+#include "arena.h"
 #include "diagram.h"
+#include "frame_capture.h"
+#include "gpu_buffer.h"
 #include "knot.h"
 #include "history.h"
+#include "image_writer.h"
+#include "mesh_export.h"
+#include "mesh_pool.h"
+#include "persistent_buffer.h"
+#include "profiler.h"
 #include "shader.h"
+#include "thread_pool.h"
 #include "to_string.h"
+#include "tube.h"
 
 // Data that will be associated with the GLFW window
 struct InputData
@@ -22,6 +41,27 @@ struct InputData
     bool imgui_active = false;
 } input_data;
 
+// Settings for rendering without a window (see `parse_arguments`)
+struct HeadlessSettings
+{
+    bool enabled = false;
+
+    // The grid diagram to render (an empty string means the first one in the "diagrams" folder)
+    std::string diagram;
+
+    // The number of frames to render, and the number of relaxation steps between consecutive frames
+    size_t frames = 1;
+    size_t steps_per_frame = 0;
+
+    // Either "png" (one image per frame) or "y4m" (a single video)
+    std::string format = "png";
+    std::string output = "frames";
+    uint32_t frames_per_second = 30;
+
+    // Where the profiler's history is written once all frames have been rendered (an empty string disables this)
+    std::string profile;
+} headless;
+
 // Viewport and camera settings
 const uint32_t window_w = 1200;
 const uint32_t window_h = 800;
@@ -46,6 +86,21 @@ ImVec4 clear_color = ImVec4(0.311f, 0.320f, 0.343f, 1.0f);
 std::vector<std::string> available_csvs;
 std::string current_csv;
 
+// Tube level of detail options ("Automatic" picks one based on the tube's size on screen)
+std::vector<std::string> tube_detail_options = { "Automatic", "High", "Medium", "Low" };
+std::string current_tube_detail = tube_detail_options[0];
+
+// Shadow filtering options, from cheapest to most expensive (the order must match `ShadowFilter` below)
+std::vector<std::string> shadow_filter_options = { "Off", "Hardware PCF", "Poisson PCF", "Variance (VSM)", "Exponential (ESM)" };
+std::string current_shadow_filter = shadow_filter_options[2];
+
+// The radius (in texels) of the Poisson disk, or of the blur that is applied to variance / exponential shadow maps:
+// the default matches the footprint of the original 41x41 PCF kernel, which also gives the tube most of its shading
+int shadow_softness = 20;
+
+// The exponent used by exponential shadow maps (larger values give sharper contact shadows, but more light leaking)
+float esm_exponent = 80.0f;
+
 // Cromwell move options
 std::vector<std::string> cromwell_moves = { "Translation", "Commutation", "Stabilization", "Destabilization" };
 std::string current_move = cromwell_moves[0];
@@ -57,14 +112,93 @@ int stabilization_index_j = 0;
 int destabilization_index_i = 0;
 int destabilization_index_j = 0;
 
+// The view of the grid diagram editor (see `draw_diagram`)
+struct GridView
+{
+    // The size of each grid cell (in pixels), or 0 if the view hasn't been set up yet
+    float cell_size = 0.0f;
+
+    // The offset of the grid's top-left corner from the editor's top-left corner (in pixels)
+    ImVec2 pan = { 0.0f, 0.0f };
+
+    // The size of the diagram that the view was set up for
+    size_t size = 0;
+
+    bool is_panning = false;
+} grid_view;
+
+// Grids with at least this many rows get an overview "minimap" in the corner of the editor
+const size_t minimap_threshold = 48;
+
 // The main window handle
 GLFWwindow* window;
 
+// The number of upcoming frames that must be drawn even if the scene hasn't changed, so that ImGui can react to the
+// latest input (it needs a couple of frames to settle after e.g. a click): while this is 0 and the simulation is
+// paused, the main loop sleeps until the next event
+int frames_to_draw = 2;
+
+// The longest that the main loop sleeps for while idle (in seconds)
+const double idle_timeout = 0.5;
+
+/**
+ * Make sure that the next few frames are drawn (called whenever an input event arrives).
+ */
+void request_redraw()
+{
+    frames_to_draw = std::max(frames_to_draw, 3);
+}
+
+/**
+ * The settings that the rendered image depends on (besides the knot itself): these are compared from one frame to
+ * the next, so that the shadow map and the scene are only re-rendered when something has actually changed.
+ */
+struct SceneSettings
+{
+    // Settings that affect the shadow map
+    glm::mat4 model_matrix;
+    std::string shadow_filter;
+    int shadow_softness;
+    float esm_exponent;
+
+    // Settings that only affect the final image
+    glm::mat4 camera_matrix;
+    float zoom;
+    ImVec4 clear_color;
+
+    bool has_same_shadows(const SceneSettings& other) const
+    {
+        return model_matrix == other.model_matrix &&
+               shadow_filter == other.shadow_filter &&
+               shadow_softness == other.shadow_softness &&
+               esm_exponent == other.esm_exponent;
+    }
+
+    bool has_same_view(const SceneSettings& other) const
+    {
+        return camera_matrix == other.camera_matrix &&
+               zoom == other.zoom &&
+               clear_color.x == other.clear_color.x &&
+               clear_color.y == other.clear_color.y &&
+               clear_color.z == other.clear_color.z &&
+               clear_color.w == other.clear_color.w;
+    }
+};
+
 /**
  * A function for handling scrolling.
  */
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
+    request_redraw();
+
+    // Scrolling over the ImGui interface (e.g. to zoom the grid diagram editor) shouldn't zoom the camera
+    auto input_data = static_cast<InputData*>(glfwGetWindowUserPointer(window));
+    if (input_data->imgui_active)
+    {
+        return;
+    }
+
     if (zoom >= 1.0f && zoom <= 90.0f)
     {
         zoom -= yoffset;
@@ -84,6 +218,8 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
  */
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
+    request_redraw();
+
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
     {
         // Close the GLFW window
@@ -134,6 +270,8 @@ glm::vec3 get_arcball_vector(int x, int y)
  */
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 {
+    request_redraw();
+
     // First, check if the user is interacting with the ImGui interface - if they are,
     // we don't want to process mouse events any further
     auto input_data = static_cast<InputData*>(glfwGetWindowUserPointer(window));
@@ -174,6 +312,22 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
     }
 }
 
+/**
+ * A function for handling mouse button presses and releases (which only matter to ImGui).
+ */
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
+{
+    request_redraw();
+}
+
+/**
+ * A function that is called whenever (part of) the window needs to be redrawn, e.g. after being uncovered.
+ */
+void refresh_callback(GLFWwindow* window)
+{
+    request_redraw();
+}
+
 /**
  * Debug function that will be used internally by OpenGL to print out warnings, errors, etc.
  */
@@ -221,90 +375,387 @@ void message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GL
 
 /**
  * Draw the UI elements corresponding to the specified grid diagram (i.e. a matrix of x's and o's).
+ *
+ * The grid is drawn directly into the window's draw list (rather than with one widget per cell), and only the rows
+ * and columns that are inside of the editor's visible area are touched, so very large diagrams stay responsive. The
+ * view can be zoomed with the mouse wheel and panned by dragging with the right (or middle) mouse button. Clicking a
+ * cell picks the row / column / cell that the current Cromwell move applies to.
  */
 void draw_diagram(const knot::Diagram& diagram)
 {
     ImGui::Text("Grid diagram is %u x %u", diagram.get_number_of_rows(), diagram.get_number_of_cols());
 
+    const auto size = diagram.get_size();
+    const auto& data = diagram.get_data();
+    auto& io = ImGui::GetIO();
+
+    // The columns of the `x` and `o` in each row: everything else is blank, so these are all that needs to be drawn
+    // (or hit-tested against)
+    std::vector<std::pair<size_t, size_t>> markers(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        const auto& row = data[i];
+        markers[i] = {
+            std::find(row.begin(), row.end(), knot::Entry::X) - row.begin(),
+            std::find(row.begin(), row.end(), knot::Entry::O) - row.begin()
+        };
+    }
+
+    // At 100% zoom, each cell is as large as the buttons that used to make up the grid
     const auto text_size = ImGui::CalcTextSize("x");
-    const auto button_dims = std::max(text_size.x, text_size.y) * 2;
+    const auto default_cell_size = std::max(text_size.x, text_size.y) * 2;
+    const auto min_cell_size = 1.0f;
+    const auto max_cell_size = default_cell_size * 4.0f;
+
+    const auto canvas_w = std::max(ImGui::GetContentRegionAvail().x, 64.0f);
+    const auto canvas_h = std::clamp(default_cell_size * size, 128.0f, 480.0f);
+
+    const auto fit = [&] {
+        grid_view.cell_size = std::clamp(std::min(canvas_w, canvas_h) / size, min_cell_size, default_cell_size);
+        grid_view.pan = {
+            (canvas_w - grid_view.cell_size * size) * 0.5f,
+            (canvas_h - grid_view.cell_size * size) * 0.5f
+        };
+    };
+    if (grid_view.cell_size == 0.0f || grid_view.size != size)
+    {
+        // The diagram was just loaded (or changed size after a (de)stabilization)
+        grid_view.size = size;
+        fit();
+    }
 
-    for (size_t i = 0; i < diagram.get_size(); ++i)
+    if (ImGui::Button("Fit"))
     {
-        for (size_t j = 0; j < diagram.get_size(); ++j)
-        {
-            std::string label = utils::to_string(diagram.get_data()[i][j]);
-            
-            // Based on the current "edit" (i.e. Cromwell) mode, highlight certain grid cells
-            bool pop_color = false;
-            auto selectable_color = ImGui::GetStyle().Colors[ImGuiCol_ButtonHovered];
-            selectable_color.x *= 0.75f;
-            selectable_color.y *= 0.75f;
-            selectable_color.z *= 0.75f;
-            const auto selected_color = ImGui::GetStyle().Colors[ImGuiCol_ButtonHovered];
+        fit();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("100%"))
+    {
+        grid_view.cell_size = default_cell_size;
+        grid_view.pan = { 0.0f, 0.0f };
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("(scroll to zoom, right-drag to pan)");
+
+    // The whole editor is a single invisible button, which all of the mouse input goes through
+    const auto canvas_min = ImGui::GetCursorScreenPos();
+    const auto canvas_max = ImVec2{ canvas_min.x + canvas_w, canvas_min.y + canvas_h };
+    ImGui::InvisibleButton("##grid", { canvas_w, canvas_h });
+    const bool hovered = ImGui::IsItemHovered();
+    const auto mouse = ImVec2{ io.MousePos.x - canvas_min.x, io.MousePos.y - canvas_min.y };
+
+    // Zoom in / out around the mouse cursor
+    if (hovered && io.MouseWheel != 0.0f)
+    {
+        const auto cell_size = std::clamp(grid_view.cell_size * std::pow(1.25f, io.MouseWheel), min_cell_size, max_cell_size);
+        const auto scale = cell_size / grid_view.cell_size;
+        grid_view.pan = {
+            mouse.x - (mouse.x - grid_view.pan.x) * scale,
+            mouse.y - (mouse.y - grid_view.pan.y) * scale
+        };
+        grid_view.cell_size = cell_size;
+    }
 
-            if (current_move == "Commutation")
+    // Pan with the right or middle mouse button (which keeps panning even if the mouse leaves the editor)
+    if (hovered && (ImGui::IsMouseClicked(1) || ImGui::IsMouseClicked(2)))
+    {
+        grid_view.is_panning = true;
+    }
+    if (grid_view.is_panning)
+    {
+        grid_view.is_panning = ImGui::IsMouseDown(1) || ImGui::IsMouseDown(2);
+        grid_view.pan.x += io.MouseDelta.x;
+        grid_view.pan.y += io.MouseDelta.y;
+    }
+
+    // Always keep at least one row and column of the grid inside of the editor
+    const auto cell_size = grid_view.cell_size;
+    const auto grid_extent = cell_size * size;
+    grid_view.pan.x = std::clamp(grid_view.pan.x, cell_size - grid_extent, canvas_w - cell_size);
+    grid_view.pan.y = std::clamp(grid_view.pan.y, cell_size - grid_extent, canvas_h - cell_size);
+
+    // The top-left corner of the grid and the range of rows / cols that are (at least partially) visible
+    const auto origin = ImVec2{ canvas_min.x + grid_view.pan.x, canvas_min.y + grid_view.pan.y };
+    const auto get_visible_range = [&](float pan, float extent) {
+        const auto first = static_cast<size_t>(std::max(std::floor(-pan / cell_size), 0.0f));
+        const auto last = static_cast<size_t>(std::clamp(std::ceil((extent - pan) / cell_size), 0.0f, static_cast<float>(size)));
+        return std::make_pair(std::min(first, last), last);
+    };
+    const auto [first_row, last_row] = get_visible_range(grid_view.pan.y, canvas_h);
+    const auto [first_col, last_col] = get_visible_range(grid_view.pan.x, canvas_w);
+
+    const auto get_cell_min = [&](size_t i, size_t j) {
+        return ImVec2{ origin.x + j * cell_size, origin.y + i * cell_size };
+    };
+    const auto get_cell_max = [&](size_t i, size_t j) {
+        return ImVec2{ origin.x + (j + 1) * cell_size, origin.y + (i + 1) * cell_size };
+    };
+
+    // Based on the current "edit" (i.e. Cromwell) mode, highlight certain grid cells
+    auto selectable_color = ImGui::GetStyle().Colors[ImGuiCol_ButtonHovered];
+    selectable_color.x *= 0.75f;
+    selectable_color.y *= 0.75f;
+    selectable_color.z *= 0.75f;
+    const auto selectable = ImGui::GetColorU32(selectable_color);
+    const auto selected = ImGui::GetColorU32(ImGuiCol_ButtonHovered);
+
+    auto draw_list = ImGui::GetWindowDrawList();
+    draw_list->PushClipRect(canvas_min, canvas_max, true);
+    draw_list->AddRectFilled(canvas_min, canvas_max, ImGui::GetColorU32(ImGuiCol_FrameBg));
+    draw_list->AddRectFilled(get_cell_min(0, 0), get_cell_max(size - 1, size - 1), ImGui::GetColorU32(ImGuiCol_Button));
+
+    if (current_move == "Commutation")
+    {
+        if (static_cast<knot::Axis>(commutation_row_or_col) == knot::Axis::ROW)
+        {
+            draw_list->AddRectFilled(get_cell_min(commutation_index, 0), get_cell_max(commutation_index, size - 1), selected);
+        }
+        else
+        {
+            draw_list->AddRectFilled(get_cell_min(0, commutation_index), get_cell_max(size - 1, commutation_index), selected);
+        }
+    }
+    else if (current_move == "Stabilization")
+    {
+        for (size_t i = first_row; i < last_row; ++i)
+        {
+            for (const auto j : { markers[i].first, markers[i].second })
             {
-                ImGui::GetColorU32(ImGuiCol_ButtonHovered);
-                if ((static_cast<knot::Axis>(commutation_row_or_col) == knot::Axis::ROW && commutation_index == i) ||
-                    (static_cast<knot::Axis>(commutation_row_or_col) == knot::Axis::COL && commutation_index == j))
-                {
-                    pop_color = true;
-                    ImGui::PushStyleColor(ImGuiCol_Button, selected_color);
-                }
+                draw_list->AddRectFilled(get_cell_min(i, j), get_cell_max(i, j), selectable);
             }
-            else if (current_move == "Stabilization")
-            {  
-                if (stabilization_index_i == i && stabilization_index_j == j)
-                {
-                    pop_color = true;
-                    ImGui::PushStyleColor(ImGuiCol_Button, selected_color);
-                }
-                else if (label != " ")
-                {
-                    pop_color = true;
-                    ImGui::PushStyleColor(ImGuiCol_Button, selectable_color);
-                }
-            }
-            else if (current_move == "Destabilization")
+        }
+        draw_list->AddRectFilled(get_cell_min(stabilization_index_i, stabilization_index_j), get_cell_max(stabilization_index_i, stabilization_index_j), selected);
+    }
+    else if (current_move == "Destabilization")
+    {
+        draw_list->AddRectFilled(get_cell_min(destabilization_index_i, destabilization_index_j), get_cell_max(destabilization_index_i + 1, destabilization_index_j + 1), selected);
+    }
+
+    // Grid lines (only once they're far enough apart to be useful)
+    if (cell_size >= 4.0f)
+    {
+        const auto line_color = ImGui::GetColorU32(ImGuiCol_Border);
+        for (size_t i = first_row; i <= last_row; ++i)
+        {
+            draw_list->AddLine(get_cell_min(i, first_col), get_cell_min(i, last_col), line_color);
+        }
+        for (size_t j = first_col; j <= last_col; ++j)
+        {
+            draw_list->AddLine(get_cell_min(first_row, j), get_cell_min(last_row, j), line_color);
+        }
+    }
+
+    // The x's and o's: as text if they fit, otherwise as small colored squares
+    const bool draw_labels = cell_size >= text_size.y;
+    const auto text_color = ImGui::GetColorU32(ImGuiCol_Text);
+    const auto o_color = ImGui::GetColorU32(ImGuiCol_PlotHistogram);
+    for (size_t i = first_row; i < last_row; ++i)
+    {
+        for (const auto entry : { knot::Entry::X, knot::Entry::O })
+        {
+            const auto j = entry == knot::Entry::X ? markers[i].first : markers[i].second;
+            if (j < first_col || j >= last_col)
             {
-                if ((destabilization_index_i == i + 0 && destabilization_index_j == j + 0) ||   // UL
-                    (destabilization_index_i == i - 1 && destabilization_index_j == j + 0) ||   // LL
-                    (destabilization_index_i == i + 0 && destabilization_index_j == j - 1) ||   // UR
-                    (destabilization_index_i == i - 1 && destabilization_index_j == j - 1))     // LR
-                {
-                    pop_color = true;
-                    ImGui::PushStyleColor(ImGuiCol_Button, selected_color);
-                }
+                continue;
             }
 
-            // If this is the last row, we only want to remove the horizontal item spacing
-            if (i != diagram.get_size() - 1)
+            const auto cell_min = get_cell_min(i, j);
+            if (draw_labels)
             {
-                ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, { 0.0f, 0.0f });
+                const auto label = utils::to_string(entry);
+                const auto label_size = ImGui::CalcTextSize(label);
+                draw_list->AddText({ cell_min.x + (cell_size - label_size.x) * 0.5f, cell_min.y + (cell_size - label_size.y) * 0.5f }, text_color, label);
             }
             else
             {
-                ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, { 0.0f, ImGui::GetStyle().ItemSpacing.y });
+                draw_list->AddRectFilled(cell_min, get_cell_max(i, j), entry == knot::Entry::X ? text_color : o_color);
             }
+        }
+    }
 
-            // Finally, draw the button
-            ImGui::Button(label.c_str(), { button_dims, button_dims });
+    // An overview of the whole diagram (for grids that are too large to see at once), which can be clicked / dragged
+    // to move the view around
+    bool minimap_hovered = false;
+    if (size >= minimap_threshold)
+    {
+        const auto minimap_size = std::min({ 128.0f, canvas_w * 0.5f, canvas_h * 0.5f });
+        const auto minimap_min = ImVec2{ canvas_max.x - minimap_size - 4.0f, canvas_min.y + 4.0f };
+        const auto minimap_max = ImVec2{ minimap_min.x + minimap_size, minimap_min.y + minimap_size };
+        const auto scale = minimap_size / size;
 
-            if (pop_color)
-            {
-                ImGui::PopStyleColor();
-            }
+        draw_list->AddRectFilled(minimap_min, minimap_max, ImGui::GetColorU32(ImGuiCol_PopupBg));
+        for (size_t i = 0; i < size; ++i)
+        {
+            const auto y = minimap_min.y + i * scale;
+            const auto x_column = minimap_min.x + markers[i].first * scale;
+            const auto o_column = minimap_min.x + markers[i].second * scale;
+            draw_list->AddRectFilled({ x_column, y }, { x_column + std::max(scale, 1.0f), y + std::max(scale, 1.0f) }, text_color);
+            draw_list->AddRectFilled({ o_column, y }, { o_column + std::max(scale, 1.0f), y + std::max(scale, 1.0f) }, o_color);
+        }
 
-            if (j != diagram.get_size() - 1)
-            {
-                ImGui::SameLine();
-            }
+        // The part of the grid that is currently visible
+        draw_list->AddRect(
+            { minimap_min.x + first_col * scale, minimap_min.y + first_row * scale },
+            { minimap_min.x + last_col * scale, minimap_min.y + last_row * scale },
+            ImGui::GetColorU32(ImGuiCol_PlotLinesHovered)
+        );
+        draw_list->AddRect(minimap_min, minimap_max, ImGui::GetColorU32(ImGuiCol_Border));
+
+        minimap_hovered = hovered &&
+                          io.MousePos.x >= minimap_min.x && io.MousePos.x < minimap_max.x &&
+                          io.MousePos.y >= minimap_min.y && io.MousePos.y < minimap_max.y;
+        if (minimap_hovered && ImGui::IsMouseDown(0))
+        {
+            // Center the view on the point under the mouse cursor
+            const auto center_x = (io.MousePos.x - minimap_min.x) / scale;
+            const auto center_y = (io.MousePos.y - minimap_min.y) / scale;
+            grid_view.pan = { canvas_w * 0.5f - center_x * cell_size, canvas_h * 0.5f - center_y * cell_size };
+        }
+    }
+
+    draw_list->PopClipRect();
+
+    // Find the cell under the mouse cursor (if any)
+    const auto hovered_j = static_cast<int>(std::floor((mouse.x - grid_view.pan.x) / cell_size));
+    const auto hovered_i = static_cast<int>(std::floor((mouse.y - grid_view.pan.y) / cell_size));
+    if (!hovered || minimap_hovered || grid_view.is_panning ||
+        hovered_i < 0 || hovered_i >= static_cast<int>(size) ||
+        hovered_j < 0 || hovered_j >= static_cast<int>(size))
+    {
+        return;
+    }
+
+    ImGui::SetTooltip("row: %d, col: %d", hovered_i, hovered_j);
+
+    // Pick the row / col / cell that the current Cromwell move applies to
+    if (ImGui::IsItemClicked(0))
+    {
+        if (current_move == "Commutation")
+        {
+            commutation_index = static_cast<knot::Axis>(commutation_row_or_col) == knot::Axis::ROW ? hovered_i : hovered_j;
+        }
+        else if (current_move == "Stabilization")
+        {
+            // Stabilizations apply to an `x` or an `o`, so snap to whichever one in this row is closest
+            const auto [x, o] = markers[hovered_i];
+            const auto distance_to_x = std::abs(static_cast<int>(x) - hovered_j);
+            const auto distance_to_o = std::abs(static_cast<int>(o) - hovered_j);
+            stabilization_index_i = hovered_i;
+            stabilization_index_j = static_cast<int>(distance_to_x <= distance_to_o ? x : o);
+        }
+        else if (current_move == "Destabilization")
+        {
+            destabilization_index_i = std::min(hovered_i, static_cast<int>(size) - 2);
+            destabilization_index_j = std::min(hovered_j, static_cast<int>(size) - 2);
+        }
+    }
+}
+
+/**
+ * Draw a rolling plot of each stage that the profiler measures.
+ */
+void draw_profiler(const graphics::Profiler& profiler)
+{
+    const auto& stages = profiler.get_stages();
+    for (size_t stage = 0; stage < stages.size(); ++stage)
+    {
+        const auto& history = profiler.get_history(stage);
+        const auto label = stages[stage].name + (stages[stage].clock == graphics::StageClock::GPU ? " (GPU)" : "");
+
+        ImGui::Text("%s: %.3f ms (average %.3f ms, max %.3f ms)", label.c_str(), profiler.get_latest(stage), profiler.get_average(stage), profiler.get_maximum(stage));
+        ImGui::PlotLines(
+            ("##" + label).c_str(),
+            history.data(),
+            static_cast<int>(history.size()),
+            static_cast<int>(profiler.get_history_offset()),
+            nullptr,
+            0.0f,
+            std::max(profiler.get_maximum(stage), 1.0f),
+            ImVec2(0.0f, 40.0f)
+        );
+    }
+}
+
+/**
+ * Draw the heap allocations that were made during the last frame, in total and per tag (e.g. per relaxation step
+ * or per move).
+ */
+void draw_allocations(const utils::AllocationCounts& frame, const utils::AllocationTracker::TagTable& tags)
+{
+    if (!utils::AllocationTracker::is_enabled())
+    {
+        ImGui::TextDisabled("Allocation tracking is disabled (build with GRIDKNOT_TRACK_ALLOCATIONS)");
+        return;
+    }
+
+    ImGui::Text("Allocations: %llu (%llu bytes) last frame", 
+        static_cast<unsigned long long>(frame.allocations), 
+        static_cast<unsigned long long>(frame.bytes));
+
+    for (const auto& tag : tags)
+    {
+        if (tag.name == nullptr || (tag.counts.allocations == 0 && tag.scopes == 0))
+        {
+            continue;
+        }
+
+        // Scopes are opened once per step / move, so show the average cost of each one as well
+        const auto scopes = std::max(tag.scopes, uint64_t{ 1 });
+        ImGui::BulletText("%s: %llu (%llu bytes), %.1f (%.0f bytes) per scope", 
+            tag.name,
+            static_cast<unsigned long long>(tag.counts.allocations),
+            static_cast<unsigned long long>(tag.counts.bytes),
+            static_cast<double>(tag.counts.allocations) / scopes,
+            static_cast<double>(tag.counts.bytes) / scopes);
+    }
+}
+
+/**
+ * Parse the command line arguments (which are only used for headless rendering).
+ */
+void parse_arguments(int argc, char* argv[])
+{
+    const auto usage = [&] {
+        std::cerr << "Usage: " << argv[0] << " [--headless [--diagram <path.csv>] [--frames <n>] [--steps-per-frame <n>]\n"
+                  << "                 [--format png|y4m] [--output <directory>] [--fps <n>] [--profile <path.csv>]]" << std::endl;
+        exit(EXIT_FAILURE);
+    };
 
-            ImGui::PopStyleVar();
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
 
+            // Returns the value that follows the current option
+            const auto value = [&] {
+                if (i + 1 >= argc)
+                {
+                    usage();
+                }
+                return std::string{ argv[++i] };
+            };
+
+            if (argument == "--headless") headless.enabled = true;
+            else if (argument == "--diagram") headless.diagram = value();
+            else if (argument == "--frames") headless.frames = std::stoul(value());
+            else if (argument == "--steps-per-frame") headless.steps_per_frame = std::stoul(value());
+            else if (argument == "--format") headless.format = value();
+            else if (argument == "--output") headless.output = value();
+            else if (argument == "--fps") headless.frames_per_second = static_cast<uint32_t>(std::stoul(value()));
+            else if (argument == "--profile") headless.profile = value();
+            else usage();
         }
     }
+    catch (const std::exception&)
+    {
+        usage();
+    }
+
+    if (headless.format != "png" && headless.format != "y4m")
+    {
+        usage();
+    }
 }
 
 /**
@@ -312,15 +763,52 @@ void draw_diagram(const knot::Diagram& diagram)
  */
 void initialize()
 {
+    // In headless mode, GLFW doesn't connect to a display server at all (this requires GLFW 3.4 or later): the
+    // context is created through EGL (e.g. Mesa's surfaceless platform) or, failing that, OSMesa, so that it
+    // runs on machines without a GPU (e.g. under llvmpipe)
+    if (headless.enabled)
+    {
+        // Older versions would quietly connect to a display server instead, which isn't there on render machines
+        int major = 0;
+        int minor = 0;
+        glfwGetVersion(&major, &minor, nullptr);
+        if (major < 3 || (major == 3 && minor < 4))
+        {
+            std::cerr << "Headless rendering requires GLFW 3.4 or later (found " << major << "." << minor << ")" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+#if GLFW_VERSION_MAJOR > 3 || (GLFW_VERSION_MAJOR == 3 && GLFW_VERSION_MINOR >= 4)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+        std::cerr << "Headless rendering requires GLFW 3.4 or later (built against " << GLFW_VERSION_MAJOR << "." << GLFW_VERSION_MINOR << ")" << std::endl;
+        exit(EXIT_FAILURE);
+#endif
+    }
+
     // Create and configure the GLFW window 
-    glfwInit();
+    if (!glfwInit())
+    {
+        std::cerr << "Failed to initialize GLFW" << (headless.enabled ? " (without a display server)" : "") << std::endl;
+        exit(EXIT_FAILURE);
+    }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, headless.enabled ? 5 : 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_RESIZABLE, false);
-    glfwWindowHint(GLFW_SAMPLES, 4);
+    if (headless.enabled)
+    {
+        glfwWindowHint(GLFW_VISIBLE, false);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    }
     window = glfwCreateWindow(window_w, window_h, "Grid Diagrams for Knots", nullptr, nullptr);
 
+    if (window == nullptr && headless.enabled)
+    {
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        window = glfwCreateWindow(window_w, window_h, "Grid Diagrams for Knots", nullptr, nullptr);
+    }
+
     if (window == nullptr)
     {
         std::cerr << "Failed to create GLFW window" << std::endl;
@@ -332,6 +820,8 @@ void initialize()
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetKeyCallback(window, key_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
+    glfwSetWindowRefreshCallback(window, refresh_callback);
     glfwSetWindowUserPointer(window, &input_data);
 
     // Load function pointers from glad
@@ -348,7 +838,7 @@ void initialize()
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
     ImGui::StyleColorsDark();
     ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 460");
+    ImGui_ImplOpenGL3_Init("#version 450");
 
     // Setup initial OpenGL state
     {
@@ -386,11 +876,48 @@ void load_csvs()
 }
 
 uint32_t vao_tube;
-uint32_t vbo_tube_position;
+std::unique_ptr<graphics::GrowableBuffer> buffer_tube_index;
+std::unique_ptr<graphics::PersistentBuffer> buffer_tube_position;
+
+// The range of `buffer_tube_index` that holds the indices for each level of detail, and the level that was last uploaded
+std::array<size_t, geom::tube_details.size()> tube_index_offsets;
+std::array<size_t, geom::tube_details.size()> tube_index_counts;
+size_t tube_detail = 0;
+
+// The stages of the main loop that are timed by the profiler (in the order that they appear in `profiler_stages`)
+enum ProfileStage
+{
+    PROFILE_FRAME,
+    PROFILE_IMGUI,
+    PROFILE_RELAX,
+    PROFILE_TUBE,
+    PROFILE_UPLOAD,
+    PROFILE_DEPTH_PASS,
+    PROFILE_DRAW_PASS,
+    PROFILE_SWAP
+};
+
+const std::vector<graphics::ProfilerStage> profiler_stages = {
+    { "Frame", graphics::StageClock::CPU },
+    { "ImGui", graphics::StageClock::CPU },
+    { "Relax", graphics::StageClock::CPU },
+    { "Generate Tube", graphics::StageClock::CPU },
+    { "Upload", graphics::StageClock::CPU },
+    { "Depth Pass", graphics::StageClock::GPU },
+    { "Draw Pass", graphics::StageClock::GPU },
+    { "Swap", graphics::StageClock::CPU }
+};
+
+// Created once the OpenGL context exists (since it owns timer queries)
+std::unique_ptr<graphics::Profiler> profiler;
+
+// Workers that the tube's rings are generated on (for large knots)
+utils::ThreadPool tube_pool;
+geom::TubeBuilder tube_builder{ &tube_pool };
 
 uint32_t vao_curve;
-uint32_t vbo_curve_position;
-uint32_t vbo_curve_stuck;
+std::unique_ptr<graphics::GrowableBuffer> buffer_curve_position;
+std::unique_ptr<graphics::PersistentBuffer> buffer_curve_stuck;
 
 uint32_t framebuffer_ui;
 uint32_t texture_ui;
@@ -399,35 +926,92 @@ uint32_t renderbuffer_ui;
 uint32_t framebuffer_depth;
 uint32_t texture_depth;
 
+// The (multisampled) offscreen framebuffer that the scene is rendered into: it holds on to the last frame, so that it
+// only has to be re-rendered when something changes, and is resolved into the window (or `framebuffer_capture`)
+uint32_t framebuffer_scene;
+uint32_t renderbuffer_scene_color;
+uint32_t renderbuffer_scene_depth;
+const int scene_samples = 4;
+
+// The offscreen framebuffer that the scene is resolved into (and read back from) in headless mode
+uint32_t framebuffer_capture;
+uint32_t texture_capture;
+
+// The moments that variance / exponential shadow maps are filtered from, plus scratch space for blurring them
+uint32_t texture_moments;
+uint32_t texture_moments_blur;
+
+// Snapshots of (relaxed) knots that are drawn next to the one being edited, so that several representatives can be
+// compared side by side: their tubes share a single vertex / index pool and are drawn with one indirect draw per pass
+std::unique_ptr<graphics::MeshPool> gallery;
+bool display_gallery = true;
+
+// The per-knot data that the render / depth shaders read from their `Instances` storage buffer (std430 layout)
+struct GalleryInstance
+{
+    glm::mat4 model;
+    glm::vec4 size_of_bounds;
+};
+std::unique_ptr<graphics::GrowableBuffer> buffer_gallery_instances;
+
+// The name and the size of the bounding box of the knot that each mesh in `gallery` was snapshotted from
+struct GalleryEntry
+{
+    std::string name;
+    glm::vec3 size_of_bounds;
+};
+std::vector<GalleryEntry> gallery_entries;
+
+// The shadow techniques that the render shader understands (see render.frag)
+enum ShadowFilter
+{
+    SHADOW_FILTER_POISSON = 0,
+    SHADOW_FILTER_HARDWARE = 1,
+    SHADOW_FILTER_VARIANCE = 2,
+    SHADOW_FILTER_EXPONENTIAL = 3
+};
+
 /**
- * Build the VAOs and VBOs used for rendering.
+ * Write the current state of the simulation (the tube's ring vertices and the "stuck" flags) straight into the
+ * persistently mapped buffers, then point the VAOs at the regions that were just written.
  */
-void build_vaos(const std::vector<glm::vec3>& tube_data,
-                const std::vector<glm::vec3>& curve_data,
-                const std::vector<int32_t>& stuck_data)
+void upload_simulation_data(const knot::Knot& knot)
 {
-    // Initialize objects for rendering the tube mesh
-    glCreateVertexArrays(1, &vao_tube);
+    // Acquiring a region may have to wait for the GPU to finish reading from it, which counts as part of the upload
+    profiler->begin(PROFILE_UPLOAD);
+    auto tube_vertices = buffer_tube_position->acquire<glm::vec3>();
+    profiler->end(PROFILE_UPLOAD);
+
+    profiler->begin(PROFILE_TUBE);
+    tube_builder.write_adaptive_vertices(knot.get_rope(), tube_vertices, geom::tube_details[tube_detail]);
+    profiler->end(PROFILE_TUBE);
 
-    glCreateBuffers(1, &vbo_tube_position);
-    glNamedBufferStorage(vbo_tube_position, sizeof(glm::vec3) * tube_data.size(), tube_data.data(), GL_DYNAMIC_STORAGE_BIT);
+    profiler->begin(PROFILE_UPLOAD);
+    glVertexArrayVertexBuffer(vao_tube, 0, buffer_tube_position->get_handle(), buffer_tube_position->get_offset(), sizeof(glm::vec3));
+
+    knot.write_stuck(buffer_curve_stuck->acquire<int32_t>());
+    glVertexArrayVertexBuffer(vao_curve, 1, buffer_curve_stuck->get_handle(), buffer_curve_stuck->get_offset(), sizeof(int32_t));
+    profiler->end(PROFILE_UPLOAD);
+}
+
+/**
+ * Create the VAOs (and the buffers that are never replaced) used for rendering: this only happens once, at startup.
+ */
+void create_vaos()
+{
+    // Initialize objects for rendering the tube mesh
+    vao_tube = graphics::create_vertex_array();
+    buffer_tube_index = std::make_unique<graphics::GrowableBuffer>(GL_STATIC_DRAW);
+    glVertexArrayElementBuffer(vao_tube, buffer_tube_index->get_handle());
 
-    glVertexArrayVertexBuffer(vao_tube, 0, vbo_tube_position, 0, sizeof(glm::vec3));
     glEnableVertexArrayAttrib(vao_tube, 0);
     glVertexArrayAttribFormat(vao_tube, 0, 3, GL_FLOAT, GL_FALSE, 0);
     glVertexArrayAttribBinding(vao_tube, 0, 0);
 
     // Initialize objects for rendering the curve mesh
-    glCreateVertexArrays(1, &vao_curve);
-
-    glCreateBuffers(1, &vbo_curve_position);
-    glNamedBufferStorage(vbo_curve_position, sizeof(glm::vec3) * curve_data.size(), curve_data.data(), GL_DYNAMIC_STORAGE_BIT);
-
-    glCreateBuffers(1, &vbo_curve_stuck);
-    glNamedBufferStorage(vbo_curve_stuck, sizeof(int32_t) * stuck_data.size(), stuck_data.data(), GL_DYNAMIC_STORAGE_BIT);
-
-    glVertexArrayVertexBuffer(vao_curve, 0, vbo_curve_position, 0, sizeof(glm::vec3));
-    glVertexArrayVertexBuffer(vao_curve, 1, vbo_curve_stuck, 0, sizeof(int32_t)); 
+    vao_curve = graphics::create_vertex_array();
+    buffer_curve_position = std::make_unique<graphics::GrowableBuffer>();
+    glVertexArrayVertexBuffer(vao_curve, 0, buffer_curve_position->get_handle(), 0, sizeof(glm::vec3));
 
     glEnableVertexArrayAttrib(vao_curve, 0);
     glVertexArrayAttribFormat(vao_curve, 0, 3, GL_FLOAT, GL_FALSE, 0);
@@ -436,6 +1020,119 @@ void build_vaos(const std::vector<glm::vec3>& tube_data,
     glEnableVertexArrayAttrib(vao_curve, 1);
     glVertexArrayAttribIFormat(vao_curve, 1, 1, GL_INT, 0); 
     glVertexArrayAttribBinding(vao_curve, 1, 1);
+
+    // Initialize the (empty) gallery
+    gallery = std::make_unique<graphics::MeshPool>();
+    buffer_gallery_instances = std::make_unique<graphics::GrowableBuffer>();
+}
+
+/**
+ * Fill in the buffers used for rendering after the topology of the knot has changed (i.e. a new diagram was loaded
+ * or a Cromwell move was applied). The buffers are reused (and only grow when they have to), so this is just a 
+ * handful of uploads.
+ */
+void update_vaos(const knot::Knot& knot, const std::vector<glm::vec3>& curve_data)
+{
+    const auto number_of_beads = knot.get_rope().get_number_of_vertices();
+
+    // The topology of the tube (at each level of detail) only depends on the number of beads, so the indices only
+    // change along with it: they are all stored back-to-back in a single buffer
+    std::vector<uint32_t> tube_indices;
+    size_t max_tube_vertex_count = 0;
+
+    for (size_t level = 0; level < geom::tube_details.size(); ++level)
+    {
+        const auto& detail = geom::tube_details[level];
+        const auto number_of_rings = geom::get_tube_ring_count(number_of_beads, detail);
+
+        tube_index_offsets[level] = tube_indices.size();
+        geom::write_tube_indices(number_of_rings, std::back_inserter(tube_indices), detail.number_of_segments);
+        tube_index_counts[level] = tube_indices.size() - tube_index_offsets[level];
+
+        max_tube_vertex_count = std::max(max_tube_vertex_count, geom::get_tube_ring_vertex_count(number_of_rings, detail.number_of_segments));
+    }
+
+    profiler->begin(PROFILE_UPLOAD);
+    buffer_tube_index->upload(tube_indices);
+    buffer_curve_position->upload(curve_data);
+    profiler->end(PROFILE_UPLOAD);
+
+    // The mapped buffers are re-bound every time they are written to, so there's nothing else to do if they grow
+    const auto reserve = [](std::unique_ptr<graphics::PersistentBuffer>& buffer, size_t region_size)
+    {
+        if (buffer)
+        {
+            buffer->reserve(region_size);
+        }
+        else
+        {
+            buffer = std::make_unique<graphics::PersistentBuffer>(graphics::grow_capacity(0, region_size));
+        }
+    };
+    reserve(buffer_tube_position, sizeof(glm::vec3) * max_tube_vertex_count);
+    reserve(buffer_curve_stuck, sizeof(int32_t) * number_of_beads);
+
+    // Fill in the first region of each of the mapped buffers
+    upload_simulation_data(knot);
+}
+
+/**
+ * Add a snapshot of the knot's current tube (at the current level of detail) to the gallery.
+ */
+void add_to_gallery(const knot::Knot& knot, const std::string& name)
+{
+    const auto& rope = knot.get_rope();
+    const auto& detail = geom::tube_details[tube_detail];
+    const auto number_of_rings = geom::get_tube_ring_count(rope.get_number_of_vertices(), detail);
+
+    std::vector<glm::vec3> vertices(geom::get_tube_ring_vertex_count(number_of_rings, detail.number_of_segments));
+    tube_builder.write_adaptive_vertices(rope, vertices.begin(), detail);
+
+    std::vector<uint32_t> indices;
+    geom::write_tube_indices(number_of_rings, std::back_inserter(indices), detail.number_of_segments);
+
+    gallery->add(vertices, indices);
+    gallery_entries.push_back({ name, rope.get_bounds().get_size() });
+}
+
+/**
+ * Arrange knots with the given bounding spheres (the knot being edited first, followed by the gallery) in a square 
+ * grid that faces the camera and is as wide as `extent`. Returns the model matrix of each knot: every knot is scaled
+ * to fit inside of its own cell, and the arcball spins each one around its own center. The matrices are allocated
+ * from `resource`.
+ */
+std::pmr::vector<glm::mat4> get_gallery_layout(const std::pmr::vector<std::pair<glm::vec3, float>>& spheres, float extent, std::pmr::memory_resource* resource)
+{
+    const auto columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<float>(spheres.size()))));
+    const auto rows = (spheres.size() + columns - 1) / columns;
+    const auto cell_size = extent / columns;
+
+    // Cells are laid out in view space, so the grid has to be rotated back into world space
+    const auto camera_to_world = glm::transpose(glm::mat3{ arcball_camera_matrix });
+
+    std::pmr::vector<glm::mat4> models{ resource };
+    models.reserve(spheres.size());
+    for (size_t i = 0; i < spheres.size(); ++i)
+    {
+        const auto [center, radius] = spheres[i];
+        const auto column = static_cast<float>(i % columns);
+        const auto row = static_cast<float>(i / columns);
+        const auto cell_center = camera_to_world * glm::vec3{
+            (column - (columns - 1) * 0.5f) * cell_size,
+            ((rows - 1) * 0.5f - row) * cell_size,
+            0.0f
+        };
+
+        // Leave a small gap between neighboring knots
+        const auto scale = 0.45f * cell_size / std::max(radius, 1e-3f);
+
+        auto model = glm::translate(glm::mat4{ 1.0f }, cell_center) * arcball_model_matrix;
+        model = glm::scale(model, glm::vec3{ scale });
+        model = glm::translate(model, -center);
+        models.push_back(model);
+    }
+
+    return models;
 }
 
 /**
@@ -475,13 +1172,32 @@ void build_fbos()
         const float border[] = { 1.0, 1.0, 1.0, 1.0 };
         glCreateTextures(GL_TEXTURE_2D, 1, &texture_depth);
         glTextureStorage2D(texture_depth, 1, GL_DEPTH_COMPONENT32F, depth_w, depth_h);
-        glTextureParameteri(texture_depth, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTextureParameteri(texture_depth, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTextureParameteri(texture_depth, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(texture_depth, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTextureParameteri(texture_depth, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
         glTextureParameteri(texture_depth, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
         glTextureParameterfv(texture_depth, GL_TEXTURE_BORDER_COLOR, border);
+
+        // The depth map is only ever sampled through a `sampler2DShadow`, so the hardware can compare (and 
+        // bilinearly filter) 4 texels per tap
+        glTextureParameteri(texture_depth, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTextureParameteri(texture_depth, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
         glNamedFramebufferTexture(framebuffer_depth, GL_DEPTH_ATTACHMENT, texture_depth, 0);
 
+        // Create the moment textures (for variance / exponential shadow maps): the first one is the color attachment, 
+        // which is blurred into the second one (horizontally) and back again (vertically)
+        for (auto texture : { &texture_moments, &texture_moments_blur })
+        {
+            glCreateTextures(GL_TEXTURE_2D, 1, texture);
+            glTextureStorage2D(*texture, 1, GL_RG32F, depth_w, depth_h);
+            glTextureParameteri(*texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTextureParameteri(*texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTextureParameteri(*texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(*texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+        glNamedFramebufferTexture(framebuffer_depth, GL_COLOR_ATTACHMENT0, texture_moments, 0);
+
+        // The color attachment is only enabled when moments are actually needed (see the depth pass)
         glNamedFramebufferDrawBuffer(framebuffer_depth, GL_NONE);
         glNamedFramebufferReadBuffer(framebuffer_depth, GL_NONE);
 
@@ -491,20 +1207,55 @@ void build_fbos()
             std::cerr << "Error: framebuffer is not complete\n";
         }
     }
+
+    // Create the offscreen framebuffer that caches the last rendered scene
+    {
+        glCreateFramebuffers(1, &framebuffer_scene);
+
+        glCreateRenderbuffers(1, &renderbuffer_scene_color);
+        glNamedRenderbufferStorageMultisample(renderbuffer_scene_color, scene_samples, GL_RGBA8, window_w, window_h);
+        glNamedFramebufferRenderbuffer(framebuffer_scene, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer_scene_color);
+
+        glCreateRenderbuffers(1, &renderbuffer_scene_depth);
+        glNamedRenderbufferStorageMultisample(renderbuffer_scene_depth, scene_samples, GL_DEPTH24_STENCIL8, window_w, window_h);
+        glNamedFramebufferRenderbuffer(framebuffer_scene, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffer_scene_depth);
+
+        if (glCheckNamedFramebufferStatus(framebuffer_scene, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cerr << "Error: framebuffer is not complete\n";
+        }
+    }
+
+    // Create the offscreen framebuffer that replaces the window's framebuffer in headless mode
+    if (headless.enabled)
+    {
+        glCreateFramebuffers(1, &framebuffer_capture);
+
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture_capture);
+        glTextureStorage2D(texture_capture, 1, GL_RGBA8, window_w, window_h);
+        glNamedFramebufferTexture(framebuffer_capture, GL_COLOR_ATTACHMENT0, texture_capture, 0);
+
+        if (glCheckNamedFramebufferStatus(framebuffer_capture, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cerr << "Error: framebuffer is not complete\n";
+        }
+    }
 }
 
-int main()
+int main(int argc, char* argv[])
 {
+    parse_arguments(argc, argv);
+
     // Setup the GUI library + OpenGL, etc.
     initialize();
 
     // Load all of the grid diagram files
     load_csvs();
-    if (available_csvs.size() == 0)
+    if (available_csvs.size() == 0 && headless.diagram.empty())
     {
         throw std::runtime_error("No .csv files found");
     }
-    current_csv = available_csvs[0];
+    current_csv = headless.diagram.empty() ? available_csvs[0] : headless.diagram;
 
     // Initialize the grid diagram
     auto diagram = knot::Diagram{ current_csv };
@@ -515,7 +1266,6 @@ int main()
     {
         knot.relax();
     }
-    auto tube = geom::generate_tube(knot.get_rope());
 
     // Command log history messages
     auto history = utils::History{};
@@ -524,19 +1274,120 @@ int main()
     auto shader_depth = graphics::Shader{ "../shaders/depth.vert", "../shaders/depth.frag" };
     auto shader_draw = graphics::Shader{ "../shaders/render.vert", "../shaders/render.frag" };
     auto shader_ui = graphics::Shader{ "../shaders/ui.vert", "../shaders/ui.frag" };
+    auto shader_blur = graphics::Shader{ "../shaders/blur.comp" };
+
+    // Resolve the uniforms that are set every frame once, up front
+    const auto u_depth_light_space_matrix = shader_depth.resolve<glm::mat4>("u_light_space_matrix");
+    const auto u_depth_model = shader_depth.resolve<glm::mat4>("u_model");
+    const auto u_depth_shadow_filter = shader_depth.resolve<int>("u_shadow_filter");
+    const auto u_depth_esm_exponent = shader_depth.resolve<float>("u_esm_exponent");
+    const auto u_depth_instanced = shader_depth.resolve<bool>("u_instanced");
+
+    const auto u_draw_display_shadows = shader_draw.resolve<bool>("u_display_shadows");
+    const auto u_draw_light_space_matrix = shader_draw.resolve<glm::mat4>("u_light_space_matrix");
+    const auto u_draw_time = shader_draw.resolve<float>("u_time");
+    const auto u_draw_projection = shader_draw.resolve<glm::mat4>("u_projection");
+    const auto u_draw_view = shader_draw.resolve<glm::mat4>("u_view");
+    const auto u_draw_model = shader_draw.resolve<glm::mat4>("u_model");
+    const auto u_draw_size_of_bounds = shader_draw.resolve<glm::vec3>("u_size_of_bounds");
+    const auto u_draw_shadow_filter = shader_draw.resolve<int>("u_shadow_filter");
+    const auto u_draw_filter_radius = shader_draw.resolve<float>("u_filter_radius");
+    const auto u_draw_esm_exponent = shader_draw.resolve<float>("u_esm_exponent");
+    const auto u_draw_instanced = shader_draw.resolve<bool>("u_instanced");
+
+    const auto u_blur_direction = shader_blur.resolve<glm::ivec2>("u_direction");
+    const auto u_blur_radius = shader_blur.resolve<int>("u_radius");
+
+    // Per-stage CPU and GPU timings
+    profiler = std::make_unique<graphics::Profiler>(profiler_stages);
+
+    const auto u_ui_number_of_vertices = shader_ui.resolve<int>("u_number_of_vertices");
+    const auto u_ui_projection = shader_ui.resolve<glm::mat4>("u_projection");
+    const auto u_ui_view = shader_ui.resolve<glm::mat4>("u_view");
+    const auto u_ui_model = shader_ui.resolve<glm::mat4>("u_model");
 
     // Create VAOs, VBOs, FBOs, textures, etc.
-    build_vaos(tube, curve.get_vertices(), knot.get_stuck());
+    create_vaos();
+    update_vaos(knot, curve.get_vertices());
     build_fbos();
 
-    while (!glfwWindowShouldClose(window))
+    // In headless mode, every frame is read back and written to disk (on a background thread)
+    std::unique_ptr<graphics::FrameCapture> capture;
+    std::ofstream video;
+    std::unique_ptr<utils::Y4MWriter> video_writer;
+    if (headless.enabled)
     {
+        std::filesystem::create_directories(headless.output);
+        const auto stem = std::filesystem::path{ current_csv }.stem().string();
+
+        if (headless.format == "y4m")
+        {
+            const auto path = (std::filesystem::path{ headless.output } / (stem + ".y4m")).string();
+            video.open(path, std::ios::binary | std::ios::trunc);
+            if (!video.is_open())
+            {
+                throw std::runtime_error("Unable to open file for writing: " + path);
+            }
+            video_writer = std::make_unique<utils::Y4MWriter>(video, headless.frames_per_second);
+
+            capture = std::make_unique<graphics::FrameCapture>(window_w, window_h, [&](size_t, const utils::Image& image) {
+                video_writer->write_frame(image);
+            });
+        }
+        else
+        {
+            capture = std::make_unique<graphics::FrameCapture>(window_w, window_h, [stem](size_t frame_index, const utils::Image& image) {
+                std::ostringstream name;
+                name << stem << "_" << std::setw(4) << std::setfill('0') << frame_index << ".png";
+                utils::save_png((std::filesystem::path{ headless.output } / name.str()).string(), image);
+            });
+        }
+    }
+
+    // The settings that the current shadow map and scene were rendered with (nothing has been rendered yet)
+    auto rendered_settings = std::optional<SceneSettings>{};
+
+    // Temporaries that only live for a single frame (e.g. the gallery's layout and draw commands) are allocated from
+    // here, and all of them are freed at once at the start of the next frame
+    auto frame_arena = utils::Arena{};
+
+    // The heap allocations made during the last frame (see `draw_allocations`), and the running totals at the start
+    // of the current one
+    auto frame_allocations = utils::AllocationCounts{};
+    auto frame_tag_allocations = utils::AllocationTracker::TagTable{};
+    auto frame_start_allocations = utils::AllocationTracker::get_total_counts();
+    auto frame_start_tag_allocations = utils::AllocationTracker::get_tag_counts();
+
+    size_t frame = 0;
+    while (headless.enabled ? frame < headless.frames : !glfwWindowShouldClose(window))
+    {
+        // Poll regular GLFW window events: when nothing is going on, sleep until something happens instead (and skip
+        // the frame altogether if it turns out that nothing did)
+        if (!headless.enabled && !simulation_active && frames_to_draw == 0)
+        {
+            glfwWaitEventsTimeout(idle_timeout);
+            if (frames_to_draw == 0)
+            {
+                continue;
+            }
+        }
+        else
+        {
+            glfwPollEvents();
+        }
+
+        profiler->begin(PROFILE_FRAME);
+        frame_arena.reset();
+
         // Update flag that denotes whether or not the user is interacting with ImGui
         ImGuiIO& io = ImGui::GetIO();
         input_data.imgui_active = io.WantCaptureMouse;
 
-        // Poll regular GLFW window events and start the ImGui frame
-        glfwPollEvents();
+        // Set whenever the knot's geometry changes this frame
+        bool geometry_changed = false;
+
+        // Start the ImGui frame
+        profiler->begin(PROFILE_IMGUI);
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -554,6 +1405,9 @@ int main()
                 ImGui::ColorEdit3("clear color", (float*)&clear_color);
                 ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 
+                const auto& counters = graphics::get_resource_counters();
+                ImGui::Text("GPU buffers: %zu live, %zu reallocation(s), %zu orphan(s)", counters.get_live_buffers(), counters.reallocations, counters.orphans);
+
                 // Drop-down menu for selecting a Cromwell move
                 ImGui::Separator();
                 if (ImGui::BeginCombo("Grid Diagram File", current_csv.c_str()))
@@ -605,6 +1459,117 @@ int main()
                 ImGui::SliderFloat("Alpha", &knot.get_simulation_params().alpha, 1.0f, 5.0f);
                 ImGui::SliderFloat("K", &knot.get_simulation_params().k, 0.0f, 15.0f);
 
+                bool continuous_collisions = knot.get_simulation_params().collision_response == knot::CollisionResponse::ADVANCE;
+                if (ImGui::Checkbox("Continuous Collisions", &continuous_collisions))
+                {
+                    knot.get_simulation_params().collision_response = continuous_collisions ? knot::CollisionResponse::ADVANCE : knot::CollisionResponse::REVERT;
+                }
+
+                // Appearance
+                ImGui::Separator();
+                if (ImGui::BeginCombo("Tube Detail", current_tube_detail.c_str()))
+                {
+                    for (const auto& option : tube_detail_options)
+                    {
+                        bool is_selected = current_tube_detail == option;
+
+                        if (ImGui::Selectable(option.c_str(), is_selected))
+                        {
+                            current_tube_detail = option;
+                        }
+                        if (is_selected)
+                        {
+                            ImGui::SetItemDefaultFocus();
+                        }
+                    }
+                    ImGui::EndCombo();
+                }
+                if (ImGui::BeginCombo("Shadow Filtering", current_shadow_filter.c_str()))
+                {
+                    for (const auto& option : shadow_filter_options)
+                    {
+                        bool is_selected = current_shadow_filter == option;
+
+                        if (ImGui::Selectable(option.c_str(), is_selected))
+                        {
+                            current_shadow_filter = option;
+                        }
+                        if (is_selected)
+                        {
+                            ImGui::SetItemDefaultFocus();
+                        }
+                    }
+                    ImGui::EndCombo();
+                }
+                ImGui::SliderInt("Shadow Softness", &shadow_softness, 1, 32);
+                if (current_shadow_filter == shadow_filter_options[4])
+                {
+                    ImGui::SliderFloat("ESM Exponent", &esm_exponent, 10.0f, 80.0f);
+                }
+                ImGui::Text("GPU time: shadows %.3f ms, scene %.3f ms", profiler->get_latest(PROFILE_DEPTH_PASS), profiler->get_latest(PROFILE_DRAW_PASS));
+
+                // Keep snapshots of the knot around, to compare them side by side
+                ImGui::Separator();
+                if (ImGui::Button("Add to Gallery"))
+                {
+                    const auto name = std::filesystem::path{ current_csv }.stem().string();
+                    add_to_gallery(knot, name);
+                    geometry_changed = true;
+
+                    std::ostringstream stream;
+                    stream << "Added " << name << " to the gallery (" << gallery_entries.size() << " knot(s))";
+                    history.push(stream.str(), utils::MessageType::INFO);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Clear Gallery"))
+                {
+                    gallery->clear();
+                    gallery_entries.clear();
+                    geometry_changed = true;
+                }
+                ImGui::SameLine();
+                if (ImGui::Checkbox("Display Gallery", &display_gallery))
+                {
+                    geometry_changed = true;
+                }
+
+                // Export the current state of the knot (next to the executable), e.g. for rendering offline
+                const auto export_mesh = [&](const std::string& suffix, bool is_tube, geom::MeshFormat format) {
+                    const auto path = std::filesystem::path{ current_csv }.stem().string() + suffix;
+
+                    try
+                    {
+                        if (is_tube)
+                        {
+                            geom::MeshExporter::save_tube(path, knot.get_rope(), format);
+                        }
+                        else
+                        {
+                            geom::MeshExporter::save_curve(path, knot.get_rope(), format);
+                        }
+
+                        history.push("Exported: " + path, utils::MessageType::INFO);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        history.push(e.what(), utils::MessageType::ERROR);
+                    }
+                };
+                if (ImGui::Button("Export Tube (PLY)"))
+                {
+                    export_mesh("_tube.ply", true, geom::MeshFormat::PLY);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Export Tube (STL)"))
+                {
+                    export_mesh("_tube.stl", true, geom::MeshFormat::STL);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Export Curve (PLY)"))
+                {
+                    export_mesh("_curve.ply", false, geom::MeshFormat::PLY);
+                }
+
                 // Console log information
                 ImGui::Separator();
                 ImGui::Text("Log");
@@ -668,6 +1633,7 @@ int main()
 
                     if (ImGui::Button("Up"))
                     {
+                        utils::AllocationScope scope{ "Move" };
                         diagram.apply_translation(knot::Direction::U);
                         topology_needs_update = true;
                         direction_message = utils::to_string(knot::Direction::U);
@@ -675,6 +1641,7 @@ int main()
                     ImGui::SameLine();
                     if (ImGui::Button("Down"))
                     {
+                        utils::AllocationScope scope{ "Move" };
                         diagram.apply_translation(knot::Direction::D);
                         topology_needs_update = true;
                         direction_message = utils::to_string(knot::Direction::D);
@@ -682,6 +1649,7 @@ int main()
                     ImGui::SameLine();
                     if (ImGui::Button("Left"))
                     {
+                        utils::AllocationScope scope{ "Move" };
                         diagram.apply_translation(knot::Direction::L);
                         topology_needs_update = true;
                         direction_message = utils::to_string(knot::Direction::L);
@@ -689,6 +1657,7 @@ int main()
                     ImGui::SameLine();
                     if (ImGui::Button("Right"))
                     {
+                        utils::AllocationScope scope{ "Move" };
                         diagram.apply_translation(knot::Direction::R);
                         topology_needs_update = true;
                         direction_message = utils::to_string(knot::Direction::R);
@@ -719,6 +1688,7 @@ int main()
                     {
                         try
                         {
+                            utils::AllocationScope scope{ "Move" };
                             diagram.apply_commutation(static_cast<knot::Axis>(commutation_row_or_col), commutation_index);
                             topology_needs_update = true;
 
@@ -752,6 +1722,7 @@ int main()
                     {
                         try
                         {
+                            utils::AllocationScope scope{ "Move" };
                             diagram.apply_stabilization(static_cast<knot::Cardinal>(stabilization_cardinal), stabilization_index_i, stabilization_index_j);
                             topology_needs_update = true;
 
@@ -780,6 +1751,7 @@ int main()
                     {
                         try
                         {
+                            utils::AllocationScope scope{ "Move" };
                             diagram.apply_destabilization(destabilization_index_i, destabilization_index_j);
                             topology_needs_update = true;
 
@@ -801,6 +1773,7 @@ int main()
                 if (topology_needs_update)
                 {
                     history.push("Updating knot...", utils::MessageType::INFO);
+                    utils::AllocationScope scope{ "Rebuild Knot" };
 
                     // Rebuild the curve that corresponds to this diagram
                     curve = diagram.generate_curve();
@@ -814,16 +1787,40 @@ int main()
                             knot.relax();
                         }
                     }
-                    tube = geom::generate_tube(knot.get_rope());
 
-                    // Rebuild VAO / VBO for tube mesh
-                    build_vaos(tube, curve.get_vertices(), knot.get_stuck());
+                    // Upload the new tube / curve topology (reusing the existing buffers)
+                    update_vaos(knot, curve.get_vertices());
+                    geometry_changed = true;
+                }
+
+                ImGui::End();
+            }
+
+            // Profiler UI window
+            {
+                ImGui::Begin("Profiler");
+
+                draw_profiler(*profiler);
+                draw_allocations(frame_allocations, frame_tag_allocations);
+
+                if (ImGui::Button("Save CSV"))
+                {
+                    try
+                    {
+                        profiler->save_csv("profile.csv");
+                        history.push("Saved profile: profile.csv", utils::MessageType::INFO);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        history.push(e.what(), utils::MessageType::ERROR);
+                    }
                 }
 
                 ImGui::End();
             }
         }
         ImGui::Render();
+        profiler->end(PROFILE_IMGUI);
         
         // Render 3D objects to UI (offscreen) framebuffer
         {
@@ -848,10 +1845,10 @@ int main()
             );
 
             shader_ui.use();
-            shader_ui.uniform_int("u_number_of_vertices", curve.get_number_of_vertices());
-            shader_ui.uniform_mat4("u_projection", projection);
-            shader_ui.uniform_mat4("u_view", view);
-            shader_ui.uniform_mat4("u_model", glm::mat4{ 1.0f });
+            shader_ui.set(u_ui_number_of_vertices, static_cast<int>(curve.get_number_of_vertices()));
+            shader_ui.set(u_ui_projection, projection);
+            shader_ui.set(u_ui_view, view);
+            shader_ui.set(u_ui_model, glm::mat4{ 1.0f });
             glBindVertexArray(vao_curve);
             glDrawArrays(GL_LINE_LOOP, 0, curve.get_number_of_vertices());
             glDrawArrays(GL_POINTS, 0, curve.get_number_of_vertices());
@@ -859,18 +1856,61 @@ int main()
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
         }
 
-        // Render 3D objects to default framebuffer
+        // Render 3D objects to the scene framebuffer (if anything has changed) and show them
         {
-            // Run physics simulation
-            if (simulation_active)
+            // Run physics simulation (a fixed number of steps per frame in headless mode)
+            const size_t steps = headless.enabled ? headless.steps_per_frame : (simulation_active ? 1 : 0);
+            profiler->begin(PROFILE_RELAX);
+            for (size_t i = 0; i < steps; ++i)
             {
+                utils::AllocationScope scope{ "Relax" };
                 knot.relax();
+            }
+            profiler->end(PROFILE_RELAX);
+            const bool knot_moved = steps > 0;
+
+            // Pick the tube's level of detail: either the one that was chosen in the UI, or one based on the tube's
+            // radius (in pixels) when viewed from the camera
+            size_t detail = 0;
+            if (current_tube_detail == tube_detail_options[0])
+            {
+                const float camera_distance = glm::length(glm::vec3{ arcball_camera_matrix[3] });
+                detail = geom::select_tube_detail(geom::get_projected_radius(0.5f, camera_distance, glm::radians(zoom), window_h));
+            }
+            else
+            {
+                detail = std::find(tube_detail_options.begin(), tube_detail_options.end(), current_tube_detail) - tube_detail_options.begin() - 1;
+            }
 
-                tube = geom::generate_tube(knot.get_rope());
-                glNamedBufferSubData(vbo_tube_position, 0, sizeof(glm::vec3) * tube.size(), tube.data());
+            if (knot_moved || detail != tube_detail)
+            {
+                tube_detail = detail;
 
-                const auto stuck = knot.get_stuck();
-                glNamedBufferSubData(vbo_curve_stuck, 0, sizeof(int32_t) * stuck.size(), stuck.data());
+                // Write the new tube mesh and "stuck" flags directly into GPU-visible memory
+                upload_simulation_data(knot);
+                geometry_changed = true;
+            }
+
+            // The shadow map only has to be rebuilt when the knot (or how it's lit) changes, and the scene only has to
+            // be re-rendered when that happens or the camera moves
+            const auto settings = SceneSettings{
+                arcball_model_matrix,
+                current_shadow_filter,
+                shadow_softness,
+                esm_exponent,
+                arcball_camera_matrix,
+                zoom,
+                clear_color
+            };
+            bool shadows_changed = geometry_changed || !rendered_settings || !settings.has_same_shadows(*rendered_settings);
+            const bool view_changed = shadows_changed || !settings.has_same_view(*rendered_settings);
+            rendered_settings = settings;
+
+            // The gallery is laid out facing the camera, so moving the camera moves the knots (and their shadows)
+            const bool show_gallery = display_gallery && gallery->get_number_of_meshes() > 0;
+            if (show_gallery)
+            {
+                shadows_changed = view_changed;
             }
 
             // Setup faux light position, projection matrix, etc.
@@ -888,29 +1928,133 @@ int main()
             const auto center_of_bounds = bounds.get_center();
             glm::mat4 translate_center = glm::mat4{ 1.0f };
             translate_center = glm::translate(translate_center, -center_of_bounds);
+            auto model = arcball_model_matrix * translate_center;
 
-           // Render pass #1: render depth
+            // When the gallery is shown, every knot (including this one) gets its own cell in a grid
+            std::pmr::vector<glm::mat4> gallery_models{ &frame_arena };
+            if (show_gallery && view_changed)
+            {
+                std::pmr::vector<std::pair<glm::vec3, float>> spheres{ &frame_arena };
+                spheres.push_back({ center_of_bounds, glm::length(size_of_bounds) * 0.5f });
+                for (const auto& mesh : gallery->get_meshes())
+                {
+                    spheres.push_back({ mesh.center, mesh.radius });
+                }
+
+                gallery_models = get_gallery_layout(spheres, glm::length(size_of_bounds), &frame_arena);
+                model = gallery_models[0];
+
+                // Upload every gallery knot's transform: culling only decides which of them get a draw command
+                std::pmr::vector<GalleryInstance> instances{ &frame_arena };
+                for (size_t i = 0; i < gallery_entries.size(); ++i)
+                {
+                    instances.push_back({ gallery_models[i + 1], glm::vec4{ gallery_entries[i].size_of_bounds, 0.0f } });
+                }
+                buffer_gallery_instances->upload(instances);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer_gallery_instances->get_handle());
+            }
+
+            // Returns the draw commands for the gallery knots whose bounding spheres are inside of a view frustum
+            const auto get_visible_gallery = [&](const glm::mat4& view_projection) {
+                const auto frustum = graphics::Frustum{ view_projection };
+                const auto& meshes = gallery->get_meshes();
+
+                std::pmr::vector<graphics::DrawElementsIndirectCommand> commands{ &frame_arena };
+                for (size_t i = 0; i < meshes.size(); ++i)
+                {
+                    const auto& gallery_model = gallery_models[i + 1];
+                    const auto center = glm::vec3{ gallery_model * glm::vec4{ meshes[i].center, 1.0f } };
+                    const auto radius = meshes[i].radius * glm::length(glm::vec3{ gallery_model[0] });
+                    if (frustum.intersects_sphere(center, radius))
+                    {
+                        commands.push_back(gallery->get_draw_command(i));
+                    }
+                }
+
+                return commands;
+            };
+
+            // Map the chosen shadow technique onto the ones that the shaders understand (the first option turns 
+            // shadows off altogether, which skips the depth pass)
+            const auto shadow_option = std::find(shadow_filter_options.begin(), shadow_filter_options.end(), current_shadow_filter) - shadow_filter_options.begin();
+            const bool display_shadows = shadow_option != 0;
+            const auto shadow_filter = std::array<ShadowFilter, 5>{
+                SHADOW_FILTER_POISSON,
+                SHADOW_FILTER_HARDWARE,
+                SHADOW_FILTER_POISSON,
+                SHADOW_FILTER_VARIANCE,
+                SHADOW_FILTER_EXPONENTIAL
+            }[shadow_option];
+            const bool uses_moments = shadow_filter == SHADOW_FILTER_VARIANCE || shadow_filter == SHADOW_FILTER_EXPONENTIAL;
+
+           // Render pass #1: render depth (and moments, if needed)
+           if (display_shadows && shadows_changed)
            {
+               profiler->begin(PROFILE_DEPTH_PASS);
+
                glViewport(0, 0, depth_w, depth_h);
                glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_depth);
+               glNamedFramebufferDrawBuffer(framebuffer_depth, uses_moments ? GL_COLOR_ATTACHMENT0 : GL_NONE);
 
-               // Clear the depth attachment (there are no color attachments)
+               // Clear the depth attachment (and the moments, to the values of a surface on the far plane)
                const float clear_depth_value = 1.0f;
                glClearNamedFramebufferfv(framebuffer_depth, GL_DEPTH, 0, &clear_depth_value);
+               if (uses_moments)
+               {
+                   const float clear_moments_value[] = {
+                       shadow_filter == SHADOW_FILTER_EXPONENTIAL ? std::exp(esm_exponent) : 1.0f,
+                       shadow_filter == SHADOW_FILTER_EXPONENTIAL ? 0.0f : 1.0f,
+                       0.0f,
+                       0.0f
+                   };
+                   glClearNamedFramebufferfv(framebuffer_depth, GL_COLOR, 0, clear_moments_value);
+               }
 
                // Draw the knot
                shader_depth.use();
-               shader_depth.uniform_mat4("u_light_space_matrix", light_space_matrix);
-               shader_depth.uniform_mat4("u_model", arcball_model_matrix * translate_center);
+               shader_depth.set(u_depth_light_space_matrix, light_space_matrix);
+               shader_depth.set(u_depth_model, model);
+               shader_depth.set(u_depth_shadow_filter, static_cast<int>(shadow_filter));
+               shader_depth.set(u_depth_esm_exponent, esm_exponent);
+               shader_depth.set(u_depth_instanced, false);
                glBindVertexArray(vao_tube);
-               glDrawArrays(GL_TRIANGLES, 0, tube.size());
+               glDrawElements(GL_TRIANGLES, tube_index_counts[tube_detail], GL_UNSIGNED_INT, (void*)(sizeof(uint32_t) * tube_index_offsets[tube_detail]));
+
+               // Draw the gallery
+               if (show_gallery)
+               {
+                   shader_depth.set(u_depth_instanced, true);
+                   gallery->draw(get_visible_gallery(light_space_matrix));
+               }
                
                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+               // Blur the moments with a separable box filter: horizontally into the scratch texture, then vertically
+               // back into the original one
+               if (uses_moments)
+               {
+                   const auto blur = [&](uint32_t source, uint32_t destination, const glm::ivec2& direction) {
+                       glBindTextureUnit(0, source);
+                       glBindImageTexture(0, destination, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32F);
+                       shader_blur.set(u_blur_direction, direction);
+                       glDispatchCompute((depth_w + 15) / 16, (depth_h + 15) / 16, 1);
+                       glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+                   };
+
+                   shader_blur.use();
+                   shader_blur.set(u_blur_radius, shadow_softness);
+                   blur(texture_moments, texture_moments_blur, glm::ivec2{ 1, 0 });
+                   blur(texture_moments_blur, texture_moments, glm::ivec2{ 0, 1 });
+               }
+
+               profiler->end(PROFILE_DEPTH_PASS);
            }
 
            // Render pass #2: draw scene with shadows
+           if (view_changed)
            {
                glViewport(0, 0, window_w, window_h);
+               glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_scene);
            
                glClearColor(clear_color.x, clear_color.y, clear_color.z, clear_color.w);
                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -922,44 +2066,134 @@ int main()
                    1000.0f
                );
 
-               // Bind the depth map from the previous render pass
+               profiler->begin(PROFILE_DRAW_PASS);
+
+               // Bind the depth map (and moments) from the previous render pass
                glBindTextureUnit(0, texture_depth);
+               glBindTextureUnit(1, texture_moments);
 
                // Draw the knot (with shadows)
                shader_draw.use();
-               shader_draw.uniform_bool("u_display_shadows", true);
-               shader_draw.uniform_mat4("u_light_space_matrix", light_space_matrix);
-               shader_draw.uniform_float("u_time", glfwGetTime());
-               shader_draw.uniform_mat4("u_projection", projection);
-               shader_draw.uniform_mat4("u_view", arcball_camera_matrix);
-               shader_draw.uniform_mat4("u_model", arcball_model_matrix * translate_center);
-               shader_draw.uniform_vec3("u_size_of_bounds", size_of_bounds);
+               shader_draw.set(u_draw_display_shadows, display_shadows);
+               shader_draw.set(u_draw_shadow_filter, static_cast<int>(shadow_filter));
+               shader_draw.set(u_draw_filter_radius, static_cast<float>(shadow_softness));
+               shader_draw.set(u_draw_esm_exponent, esm_exponent);
+               shader_draw.set(u_draw_light_space_matrix, light_space_matrix);
+               shader_draw.set(u_draw_time, static_cast<float>(glfwGetTime()));
+               shader_draw.set(u_draw_projection, projection);
+               shader_draw.set(u_draw_view, arcball_camera_matrix);
+               shader_draw.set(u_draw_model, model);
+               shader_draw.set(u_draw_size_of_bounds, size_of_bounds);
+               shader_draw.set(u_draw_instanced, false);
                glBindVertexArray(vao_tube);
-               glDrawArrays(GL_TRIANGLES, 0, tube.size());
+               glDrawElements(GL_TRIANGLES, tube_index_counts[tube_detail], GL_UNSIGNED_INT, (void*)(sizeof(uint32_t) * tube_index_offsets[tube_detail]));
+
+               // Draw the gallery
+               if (show_gallery)
+               {
+                   shader_draw.set(u_draw_instanced, true);
+                   gallery->draw(get_visible_gallery(projection * arcball_camera_matrix));
+               }
+
+               profiler->end(PROFILE_DRAW_PASS);
            }
+
+           // Resolve the (possibly cached) scene into the window or, in headless mode, the capture framebuffer
+           const uint32_t framebuffer_output = headless.enabled ? framebuffer_capture : 0;
+           glBlitNamedFramebuffer(framebuffer_scene, framebuffer_output, 0, 0, window_w, window_h, 0, 0, window_w, window_h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+           glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_output);
+        }
+
+        // Draw the ImGui window (which isn't part of the captured frames)
+        if (!headless.enabled)
+        {
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         }
 
-        // Draw the ImGui window
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        // All of this frame's draw calls that read from the mapped buffers have been issued
+        buffer_tube_position->fence();
+        buffer_curve_stuck->fence();
+
+        profiler->begin(PROFILE_SWAP);
+        if (headless.enabled)
+        {
+            capture->capture(framebuffer_capture);
+        }
+        else
+        {
+            glfwSwapBuffers(window);
+        }
+        profiler->end(PROFILE_SWAP);
+
+        profiler->end(PROFILE_FRAME);
+        profiler->end_frame();
+        frame++;
+
+        {
+            const auto allocations = utils::AllocationTracker::get_total_counts();
+            const auto tag_allocations = utils::AllocationTracker::get_tag_counts();
+
+            frame_allocations = allocations - frame_start_allocations;
+            for (size_t i = 0; i < tag_allocations.size(); ++i)
+            {
+                frame_tag_allocations[i].name = tag_allocations[i].name;
+                frame_tag_allocations[i].counts = tag_allocations[i].counts - frame_start_tag_allocations[i].counts;
+                frame_tag_allocations[i].scopes = tag_allocations[i].scopes - frame_start_tag_allocations[i].scopes;
+            }
 
-        glfwSwapBuffers(window);
+            frame_start_allocations = allocations;
+            frame_start_tag_allocations = tag_allocations;
+        }
+        frames_to_draw = std::max(frames_to_draw - 1, 0);
     }
 
+    if (capture)
+    {
+        capture->finish();
+        std::cout << "Wrote " << capture->get_number_of_frames() << " frame(s) to " << headless.output << std::endl;
+        capture.reset();
+    }
+    if (!headless.profile.empty())
+    {
+        profiler->save_csv(headless.profile);
+    }
+    if (headless.enabled && utils::AllocationTracker::is_enabled())
+    {
+        utils::write_allocation_report(std::cout);
+    }
+    profiler.reset();
+
     // Clean-up UI bits
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
     // Delete OpenGL objects
-    glDeleteVertexArrays(1, &vao_curve);
-    glDeleteVertexArrays(1, &vao_tube);
-    glDeleteBuffers(1, &vbo_curve_position);
-    glDeleteBuffers(1, &vbo_curve_stuck);
-    glDeleteBuffers(1, &vbo_tube_position);
+    graphics::delete_vertex_array(vao_curve);
+    graphics::delete_vertex_array(vao_tube);
+    buffer_tube_index.reset();
+    buffer_curve_position.reset();
+    buffer_curve_stuck.reset();
+    buffer_tube_position.reset();
+    gallery.reset();
+    buffer_gallery_instances.reset();
     glDeleteTextures(1, &texture_depth);
+    glDeleteTextures(1, &texture_moments);
+    glDeleteTextures(1, &texture_moments_blur);
     glDeleteTextures(1, &texture_ui);
     glDeleteFramebuffers(1, &framebuffer_depth);
     glDeleteFramebuffers(1, &framebuffer_ui);
+    glDeleteRenderbuffers(1, &renderbuffer_scene_color);
+    glDeleteRenderbuffers(1, &renderbuffer_scene_depth);
+    glDeleteFramebuffers(1, &framebuffer_scene);
+    if (headless.enabled)
+    {
+        glDeleteTextures(1, &texture_capture);
+        glDeleteFramebuffers(1, &framebuffer_capture);
+    }
+
+    // Every buffer and VAO should have been deleted by now
+    graphics::get_resource_counters().report_leaks();
 
     // Clean-up GLFW
     glfwDestroyWindow(window);